@@ -0,0 +1,549 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <optional>
+#include <span>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#include "hash_algorithms.hpp"
+#include "pcr_replay.hpp"
+#include "sha.hpp"
+#include "tcg_parser.hpp"
+
+namespace tcg_parser
+{
+	namespace details
+	{
+		// The message of a SHA-256 extend is one block that holds the PCR and the digest, followed by a block that
+		// holds nothing but the padding. That second block is the same for every extend, so its message schedule is
+		// computed once, with the round constants already added.
+		constexpr auto sha256_extend_padding = [] {
+			std::array<uint32_t, 64> words {};
+
+			words[0] = 0x80000000;
+			words[15] = 512;
+
+			for (std::size_t t = 16; t < 64; t++)
+			{
+				auto s0 = std::rotr(words[t - 15], 7) ^ std::rotr(words[t - 15], 18) ^ (words[t - 15] >> 3);
+				auto s1 = std::rotr(words[t - 2], 17) ^ std::rotr(words[t - 2], 19) ^ (words[t - 2] >> 10);
+
+				words[t] = words[t - 16] + s0 + words[t - 7] + s1;
+			}
+
+			for (std::size_t t = 0; t < 64; t++)
+			{
+				words[t] += sha256_constants[t];
+			}
+
+			return words;
+		}();
+
+		// The same, with each word repeated for every lane of a multi-buffer kernel
+		template <std::size_t Lanes>
+		alignas(64) constexpr auto sha256_extend_padding_lanes = [] {
+			std::array<uint32_t, 64 * Lanes> words {};
+
+			for (std::size_t t = 0; t < 64; t++)
+			{
+				std::fill_n(words.begin() + t * Lanes, Lanes, sha256_extend_padding[t]);
+			}
+
+			return words;
+		}();
+
+		// Extends lanes PCRs at once, pcrs[i] = SHA-256(pcrs[i] || digests[i]), where every pointer refers to 32 bytes
+		using sha256_extend_lanes_t = void (*)(std::byte* const* pcrs, const std::byte* const* digests);
+
+		void sha256_extend_x1(std::byte* const* pcrs, const std::byte* const* digests)
+		{
+			std::array<std::byte, 64> message;
+
+			std::memcpy(message.data(), pcrs[0], 32);
+			std::memcpy(message.data() + 32, digests[0], 32);
+
+			auto value = hash(TPM_ALG_SHA256, message);
+
+			std::memcpy(pcrs[0], value.data(), 32);
+		}
+
+#if defined(__x86_64__) || defined(__i386__)
+		// Turns the eight words of each of eight lanes into eight vectors of one word from every lane, and back
+		__attribute__((target("avx2"))) void transpose_x8(__m256i* rows)
+		{
+			auto t0 = _mm256_unpacklo_epi32(rows[0], rows[1]);
+			auto t1 = _mm256_unpackhi_epi32(rows[0], rows[1]);
+			auto t2 = _mm256_unpacklo_epi32(rows[2], rows[3]);
+			auto t3 = _mm256_unpackhi_epi32(rows[2], rows[3]);
+			auto t4 = _mm256_unpacklo_epi32(rows[4], rows[5]);
+			auto t5 = _mm256_unpackhi_epi32(rows[4], rows[5]);
+			auto t6 = _mm256_unpacklo_epi32(rows[6], rows[7]);
+			auto t7 = _mm256_unpackhi_epi32(rows[6], rows[7]);
+
+			auto u0 = _mm256_unpacklo_epi64(t0, t2);
+			auto u1 = _mm256_unpackhi_epi64(t0, t2);
+			auto u2 = _mm256_unpacklo_epi64(t1, t3);
+			auto u3 = _mm256_unpackhi_epi64(t1, t3);
+			auto u4 = _mm256_unpacklo_epi64(t4, t6);
+			auto u5 = _mm256_unpackhi_epi64(t4, t6);
+			auto u6 = _mm256_unpacklo_epi64(t5, t7);
+			auto u7 = _mm256_unpackhi_epi64(t5, t7);
+
+			rows[0] = _mm256_permute2x128_si256(u0, u4, 0x20);
+			rows[1] = _mm256_permute2x128_si256(u1, u5, 0x20);
+			rows[2] = _mm256_permute2x128_si256(u2, u6, 0x20);
+			rows[3] = _mm256_permute2x128_si256(u3, u7, 0x20);
+			rows[4] = _mm256_permute2x128_si256(u0, u4, 0x31);
+			rows[5] = _mm256_permute2x128_si256(u1, u5, 0x31);
+			rows[6] = _mm256_permute2x128_si256(u2, u6, 0x31);
+			rows[7] = _mm256_permute2x128_si256(u3, u7, 0x31);
+		}
+
+		// Loads 32 big-endian bytes from each of eight lanes as eight vectors of words
+		__attribute__((target("avx2"))) void load_lanes_x8(const std::byte* const* lanes, __m256i* words)
+		{
+			auto shuffle = _mm256_set_epi64x(
+				0x0c0d0e0f08090a0b,
+				0x0405060700010203,
+				0x0c0d0e0f08090a0b,
+				0x0405060700010203
+			);
+
+			for (std::size_t i = 0; i < 8; i++)
+			{
+				auto row = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lanes[i]));
+
+				words[i] = _mm256_shuffle_epi8(row, shuffle);
+			}
+
+			transpose_x8(words);
+		}
+
+		__attribute__((target("avx2"))) void store_lanes_x8(std::byte* const* lanes, __m256i* words)
+		{
+			auto shuffle = _mm256_set_epi64x(
+				0x0c0d0e0f08090a0b,
+				0x0405060700010203,
+				0x0c0d0e0f08090a0b,
+				0x0405060700010203
+			);
+
+			transpose_x8(words);
+
+			for (std::size_t i = 0; i < 8; i++)
+			{
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes[i]), _mm256_shuffle_epi8(words[i], shuffle));
+			}
+		}
+
+		__attribute__((target("avx2"))) __m256i rotr_x8(__m256i value, int count)
+		{
+			return _mm256_or_si256(_mm256_srli_epi32(value, count), _mm256_slli_epi32(value, 32 - count));
+		}
+
+		// Runs the 64 rounds on eight states at once and adds the result to them, given the message words of every
+		// round with the round constants already added
+		__attribute__((target("avx2"))) void sha256_rounds_x8(__m256i* state, const __m256i* words)
+		{
+			auto a = state[0], b = state[1], c = state[2], d = state[3];
+			auto e = state[4], f = state[5], g = state[6], h = state[7];
+
+#pragma GCC unroll 64
+			for (std::size_t t = 0; t < 64; t++)
+			{
+				auto s1 = _mm256_xor_si256(_mm256_xor_si256(rotr_x8(e, 6), rotr_x8(e, 11)), rotr_x8(e, 25));
+				auto ch = _mm256_xor_si256(_mm256_and_si256(e, f), _mm256_andnot_si256(e, g));
+				auto t1 = _mm256_add_epi32(_mm256_add_epi32(h, s1), _mm256_add_epi32(ch, words[t]));
+				auto s0 = _mm256_xor_si256(_mm256_xor_si256(rotr_x8(a, 2), rotr_x8(a, 13)), rotr_x8(a, 22));
+				auto maj = _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(c, _mm256_or_si256(a, b)));
+
+				h = g;
+				g = f;
+				f = e;
+				e = _mm256_add_epi32(d, t1);
+				d = c;
+				c = b;
+				b = a;
+				a = _mm256_add_epi32(t1, _mm256_add_epi32(s0, maj));
+			}
+
+			state[0] = _mm256_add_epi32(state[0], a);
+			state[1] = _mm256_add_epi32(state[1], b);
+			state[2] = _mm256_add_epi32(state[2], c);
+			state[3] = _mm256_add_epi32(state[3], d);
+			state[4] = _mm256_add_epi32(state[4], e);
+			state[5] = _mm256_add_epi32(state[5], f);
+			state[6] = _mm256_add_epi32(state[6], g);
+			state[7] = _mm256_add_epi32(state[7], h);
+		}
+
+		__attribute__((target("avx2"))) void sha256_extend_x8(std::byte* const* pcrs, const std::byte* const* digests)
+		{
+			__m256i w[64];
+			__m256i state[8];
+
+			load_lanes_x8(pcrs, w);
+			load_lanes_x8(digests, w + 8);
+
+#pragma GCC unroll 48
+			for (std::size_t t = 16; t < 64; t++)
+			{
+				auto s0 = _mm256_xor_si256(
+					_mm256_xor_si256(rotr_x8(w[t - 15], 7), rotr_x8(w[t - 15], 18)),
+					_mm256_srli_epi32(w[t - 15], 3)
+				);
+				auto s1 = _mm256_xor_si256(
+					_mm256_xor_si256(rotr_x8(w[t - 2], 17), rotr_x8(w[t - 2], 19)),
+					_mm256_srli_epi32(w[t - 2], 10)
+				);
+
+				w[t] = _mm256_add_epi32(_mm256_add_epi32(w[t - 16], s0), _mm256_add_epi32(w[t - 7], s1));
+			}
+
+			for (std::size_t t = 0; t < 64; t++)
+			{
+				w[t] = _mm256_add_epi32(w[t], _mm256_set1_epi32(static_cast<int>(sha256_constants[t])));
+			}
+
+			for (std::size_t i = 0; i < 8; i++)
+			{
+				state[i] = _mm256_set1_epi32(static_cast<int>(sha256_initial[i]));
+			}
+
+			sha256_rounds_x8(state, w);
+			sha256_rounds_x8(state, reinterpret_cast<const __m256i*>(sha256_extend_padding_lanes<8>.data()));
+
+			store_lanes_x8(pcrs, state);
+		}
+
+		// Same as above with sixteen lanes, where three-input logic and rotates are single instructions
+		__attribute__((target("avx512f,avx2"))) void sha256_rounds_x16(__m512i* state, const __m512i* words)
+		{
+			auto a = state[0], b = state[1], c = state[2], d = state[3];
+			auto e = state[4], f = state[5], g = state[6], h = state[7];
+
+#pragma GCC unroll 64
+			for (std::size_t t = 0; t < 64; t++)
+			{
+				auto s1 = _mm512_ternarylogic_epi32(
+					_mm512_ror_epi32(e, 6),
+					_mm512_ror_epi32(e, 11),
+					_mm512_ror_epi32(e, 25),
+					0x96
+				);
+				auto ch = _mm512_ternarylogic_epi32(e, f, g, 0xca);
+				auto t1 = _mm512_add_epi32(_mm512_add_epi32(h, s1), _mm512_add_epi32(ch, words[t]));
+				auto s0 = _mm512_ternarylogic_epi32(
+					_mm512_ror_epi32(a, 2),
+					_mm512_ror_epi32(a, 13),
+					_mm512_ror_epi32(a, 22),
+					0x96
+				);
+				auto maj = _mm512_ternarylogic_epi32(a, b, c, 0xe8);
+
+				h = g;
+				g = f;
+				f = e;
+				e = _mm512_add_epi32(d, t1);
+				d = c;
+				c = b;
+				b = a;
+				a = _mm512_add_epi32(t1, _mm512_add_epi32(s0, maj));
+			}
+
+			state[0] = _mm512_add_epi32(state[0], a);
+			state[1] = _mm512_add_epi32(state[1], b);
+			state[2] = _mm512_add_epi32(state[2], c);
+			state[3] = _mm512_add_epi32(state[3], d);
+			state[4] = _mm512_add_epi32(state[4], e);
+			state[5] = _mm512_add_epi32(state[5], f);
+			state[6] = _mm512_add_epi32(state[6], g);
+			state[7] = _mm512_add_epi32(state[7], h);
+		}
+
+		// Loads sixteen lanes as two halves of eight, since shuffling bytes across 512 bits needs AVX-512BW
+		__attribute__((target("avx512f,avx2"))) void load_lanes_x16(const std::byte* const* lanes, __m512i* words)
+		{
+			__m256i low[8];
+			__m256i high[8];
+
+			load_lanes_x8(lanes, low);
+			load_lanes_x8(lanes + 8, high);
+
+			for (std::size_t i = 0; i < 8; i++)
+			{
+				words[i] = _mm512_inserti64x4(_mm512_castsi256_si512(low[i]), high[i], 1);
+			}
+		}
+
+		__attribute__((target("avx512f,avx2"))) void store_lanes_x16(std::byte* const* lanes, const __m512i* words)
+		{
+			__m256i low[8];
+			__m256i high[8];
+
+			for (std::size_t i = 0; i < 8; i++)
+			{
+				low[i] = _mm512_castsi512_si256(words[i]);
+				high[i] = _mm512_extracti64x4_epi64(words[i], 1);
+			}
+
+			store_lanes_x8(lanes, low);
+			store_lanes_x8(lanes + 8, high);
+		}
+
+		__attribute__((target("avx512f,avx2"))) void sha256_extend_x16(
+			std::byte* const* pcrs,
+			const std::byte* const* digests
+		)
+		{
+			__m512i w[64];
+			__m512i state[8];
+
+			load_lanes_x16(pcrs, w);
+			load_lanes_x16(digests, w + 8);
+
+#pragma GCC unroll 48
+			for (std::size_t t = 16; t < 64; t++)
+			{
+				auto s0 = _mm512_ternarylogic_epi32(
+					_mm512_ror_epi32(w[t - 15], 7),
+					_mm512_ror_epi32(w[t - 15], 18),
+					_mm512_srli_epi32(w[t - 15], 3),
+					0x96
+				);
+				auto s1 = _mm512_ternarylogic_epi32(
+					_mm512_ror_epi32(w[t - 2], 17),
+					_mm512_ror_epi32(w[t - 2], 19),
+					_mm512_srli_epi32(w[t - 2], 10),
+					0x96
+				);
+
+				w[t] = _mm512_add_epi32(_mm512_add_epi32(w[t - 16], s0), _mm512_add_epi32(w[t - 7], s1));
+			}
+
+			for (std::size_t t = 0; t < 64; t++)
+			{
+				w[t] = _mm512_add_epi32(w[t], _mm512_set1_epi32(static_cast<int>(sha256_constants[t])));
+			}
+
+			for (std::size_t i = 0; i < 8; i++)
+			{
+				state[i] = _mm512_set1_epi32(static_cast<int>(sha256_initial[i]));
+			}
+
+			sha256_rounds_x16(state, w);
+			sha256_rounds_x16(state, reinterpret_cast<const __m512i*>(sha256_extend_padding_lanes<16>.data()));
+
+			store_lanes_x16(pcrs, state);
+		}
+#endif
+
+		struct sha256_extend_kernel
+		{
+			sha256_extend_lanes_t extend;
+			std::size_t lanes;
+		};
+
+		sha256_extend_kernel select_sha256_extend()
+		{
+#if defined(__x86_64__) || defined(__i386__)
+			if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx2"))
+			{
+				return { sha256_extend_x16, 16 };
+			}
+
+			if (__builtin_cpu_supports("avx2"))
+			{
+				return { sha256_extend_x8, 8 };
+			}
+#endif
+
+			return { sha256_extend_x1, 1 };
+		}
+
+		// Runs independent hash chains through a multi-buffer kernel. Each lane takes a chain and keeps it until all
+		// its digests are extended, then takes the next; lanes without a chain left extend a scratch value. The
+		// longest chains go first so that few lanes are left idle at the end, and once no more than a quarter of the
+		// lanes are busy, they are extended one at a time instead.
+		void sha256_extend_chains(
+			sha256_extend_kernel kernel,
+			std::span<std::array<std::byte, 32>> values,
+			std::span<const std::array<std::byte, 32>> digests,
+			std::span<const std::size_t> offsets
+		)
+		{
+			std::vector<std::size_t> order(size(values));
+
+			std::iota(order.begin(), order.end(), std::size_t(0));
+			std::ranges::stable_sort(order, std::greater(), [&](std::size_t chain) {
+				return offsets[chain + 1] - offsets[chain];
+			});
+
+			std::array<std::byte, 32> scratch {};
+			std::array<std::byte*, 16> pcrs;
+			std::array<const std::byte*, 16> lane_digests;
+			// The next digest of each lane and the end of its chain, equal when the lane has nothing to do
+			std::array<std::size_t, 16> next {};
+			std::array<std::size_t, 16> last {};
+
+			auto chain = order.begin();
+
+			while (true)
+			{
+				std::size_t busy = 0;
+
+				for (std::size_t lane = 0; lane < kernel.lanes; lane++)
+				{
+					if (next[lane] == last[lane] && chain != order.end() && offsets[*chain + 1] != offsets[*chain])
+					{
+						pcrs[lane] = values[*chain].data();
+						next[lane] = offsets[*chain];
+						last[lane] = offsets[*chain + 1];
+						chain++;
+					}
+
+					if (next[lane] == last[lane])
+					{
+						pcrs[lane] = scratch.data();
+						lane_digests[lane] = scratch.data();
+						continue;
+					}
+
+					lane_digests[lane] = digests[next[lane]++].data();
+					busy++;
+				}
+
+				if (busy == 0)
+				{
+					return;
+				}
+
+				if (busy > kernel.lanes / 4)
+				{
+					kernel.extend(pcrs.data(), lane_digests.data());
+					continue;
+				}
+
+				for (std::size_t lane = 0; lane < kernel.lanes; lane++)
+				{
+					if (pcrs[lane] != scratch.data())
+					{
+						sha256_extend_x1(&pcrs[lane], &lane_digests[lane]);
+					}
+				}
+			}
+		}
+	} // namespace details
+
+	// Replays many logs at once, with the same results as replay_log on each of them. A single replay is a serial
+	// hash chain, but the chains of different PCRs, within a log or across logs, do not depend on each other, so the
+	// SHA-256 banks of all logs go through a multi-buffer kernel that extends 16 chains at a time with AVX-512 or 8
+	// with AVX2. Banks of other algorithms are replayed one extend at a time. Fails for the logs that do not start
+	// with a spec ID event.
+	std::vector<std::optional<pcr_replay>> replay_logs(std::span<const std::span<const std::byte>> logs)
+	{
+		static const auto kernel = details::select_sha256_extend();
+
+		std::vector<std::optional<pcr_replay>> replays;
+		// The SHA-256 digests of the logs in order, each with its chain, chain = log * pcr_count + pcr_index
+		std::vector<std::pair<std::size_t, std::array<std::byte, 32>>> extends;
+
+		for (auto input : logs)
+		{
+			auto& replay = replays.emplace_back();
+			auto header = read_event_1(input);
+			auto spec_event = header ? std::get_if<events::efi_spec_id>(&header->event) : nullptr;
+
+			if (!spec_event)
+			{
+				continue;
+			}
+
+			replay.emplace(spec_event->digest_sizes);
+
+			auto hash_algs = replay->hash_algs();
+			auto batched = std::ranges::find(hash_algs, TPM_ALG_SHA256) != hash_algs.end();
+
+			// The SHA-256 bank keeps its initial values, which still take a StartupLocality event into account
+			std::erase(hash_algs, TPM_ALG_SHA256);
+
+			event_framer framer(spec_event->digest_sizes);
+
+			while (auto view = framer(input))
+			{
+				replay->extend(*view, hash_algs);
+
+				if (!batched || view->pcr_index >= pcr_count || view->event_type == EV_NO_ACTION)
+				{
+					continue;
+				}
+
+				auto chain = (size(replays) - 1) * pcr_count + view->pcr_index;
+
+				details::for_each_digest(*view, spec_event->digest_sizes, [&](uint16_t hash_alg, auto digest) {
+					if (hash_alg == TPM_ALG_SHA256 && size(digest) == 32)
+					{
+						auto& extend = extends.emplace_back(chain, std::array<std::byte, 32> {});
+
+						std::memcpy(extend.second.data(), digest.data(), 32);
+					}
+				});
+			}
+		}
+
+		auto chains = size(replays) * pcr_count;
+		std::vector<std::size_t> offsets(chains + 1);
+		std::vector<std::array<std::byte, 32>> digests(size(extends));
+
+		// Groups the digests by chain, keeping their order, in one block of memory that each lane reads in sequence
+		for (auto& [chain, digest] : extends)
+		{
+			offsets[chain + 1]++;
+		}
+
+		std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+		auto positions = offsets;
+
+		for (auto& [chain, digest] : extends)
+		{
+			digests[positions[chain]++] = digest;
+		}
+
+		std::vector<std::array<std::byte, 32>> values(chains);
+
+		for (std::size_t chain = 0; chain < chains; chain++)
+		{
+			if (offsets[chain + 1] != offsets[chain])
+			{
+				auto value = replays[chain / pcr_count]->value(TPM_ALG_SHA256, chain % pcr_count);
+
+				std::ranges::copy(value.bytes(), values[chain].begin());
+			}
+		}
+
+		details::sha256_extend_chains(kernel, values, digests, offsets);
+
+		for (std::size_t chain = 0; chain < chains; chain++)
+		{
+			if (offsets[chain + 1] != offsets[chain])
+			{
+				replays[chain / pcr_count]->set_value(TPM_ALG_SHA256, chain % pcr_count, values[chain]);
+			}
+		}
+
+		return replays;
+	}
+} // namespace tcg_parser
@@ -0,0 +1,1977 @@
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <format>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <new>
+#include <span>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "batch_replay.hpp"
+#include "diff.hpp"
+#include "digest_baseline.hpp"
+#include "digest_verifier.hpp"
+#include "event_cache.hpp"
+#include "event_filter.hpp"
+#include "event_index.hpp"
+#include "event_views.hpp"
+#include "hex.hpp"
+#include "intern.hpp"
+#include "json.hpp"
+#include "log_generator.hpp"
+#include "mapped_file.hpp"
+#include "parallel.hpp"
+#include "pcr_replay.hpp"
+#include "parse_limits.hpp"
+#include "push_parser.hpp"
+#include "replay_checkpoints.hpp"
+#include "sha.hpp"
+#include "tcg_parser.hpp"
+#include "writer.hpp"
+
+namespace
+{
+	std::atomic<std::size_t> allocation_count;
+	std::atomic<std::size_t> allocation_bytes;
+
+	// Counts and makes every allocation of the program, so that benchmarks can report allocations per event and the
+	// checks can tell how many bytes parsing asks for. Memory from std::aligned_alloc is freed like that of malloc.
+	void* allocate(std::size_t size, std::size_t alignment) noexcept
+	{
+		allocation_count.fetch_add(1, std::memory_order_relaxed);
+		allocation_bytes.fetch_add(size, std::memory_order_relaxed);
+
+		size = size ? size : 1;
+
+		if (alignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+		{
+			return std::malloc(size);
+		}
+
+		return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+	}
+
+	void* allocate_or_throw(std::size_t size, std::size_t alignment)
+	{
+		if (auto pointer = allocate(size, alignment))
+		{
+			return pointer;
+		}
+
+		throw std::bad_alloc();
+	}
+}
+
+// All the replaceable forms are replaced, as the library is free to implement the ones left out without going through
+// the others
+void* operator new(std::size_t size)
+{
+	return allocate_or_throw(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void* operator new[](std::size_t size)
+{
+	return allocate_or_throw(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+	return allocate_or_throw(size, std::size_t(alignment));
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+	return allocate_or_throw(size, std::size_t(alignment));
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+	return allocate(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+	return allocate(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return allocate(size, std::size_t(alignment));
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return allocate(size, std::size_t(alignment));
+}
+
+void operator delete(void* pointer) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete[](void* pointer, std::align_val_t) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t, std::align_val_t) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t, std::align_val_t) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete(void* pointer, std::align_val_t, const std::nothrow_t&) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete[](void* pointer, std::align_val_t, const std::nothrow_t&) noexcept
+{
+	std::free(pointer);
+}
+
+extern char** environ;
+
+namespace
+{
+	// Keeps the compiler from discarding a result that is never used
+	template <typename T>
+	void keep(const T& value)
+	{
+		asm volatile("" : : "r"(&value) : "memory");
+	}
+
+	struct bench_options
+	{
+		tcg_parser::log_generator_options log;
+		std::chrono::duration<double> min_time { 0.5 };
+		std::string filter;
+	};
+
+	class bench_runner
+	{
+	public:
+		explicit bench_runner(const bench_options& options)
+			: m_options(options)
+		{
+			std::cout << std::format(
+				"{:<40} {:>14} {:>12} {:>10} {:>14}\n",
+				"benchmark",
+				"events/s",
+				"MB/s",
+				"logs/s",
+				"allocs/event"
+			);
+		}
+
+		// Calls function until min_time has passed and reports its throughput, given the number of events and bytes
+		// that a single call processes. Each call goes over the whole log once, or over the part of it the benchmark
+		// is about, which makes calls per second the logs per second. Calls that go over several logs pass their count.
+		void run(std::string_view name, std::size_t events, std::size_t bytes, auto&& function, std::size_t logs = 1)
+		{
+			if (name.find(m_options.filter) == std::string_view::npos)
+			{
+				return;
+			}
+
+			function();
+
+			auto allocations = allocation_count.load();
+			auto start = std::chrono::steady_clock::now();
+
+			std::size_t iterations = 0;
+			std::chrono::duration<double> elapsed;
+
+			do
+			{
+				function();
+
+				iterations++;
+				elapsed = std::chrono::steady_clock::now() - start;
+			} while (elapsed < m_options.min_time);
+
+			allocations = allocation_count.load() - allocations;
+
+			auto seconds = elapsed.count() / iterations;
+
+			std::cout << std::format(
+				"{:<40} {:>14.0f} {:>12.1f} {:>10.1f} {:>14.2f}\n",
+				name,
+				events / seconds,
+				bytes / seconds / 1e6,
+				logs / seconds,
+				events ? double(allocations) / iterations / events : 0.0
+			);
+		}
+
+	private:
+		const bench_options& m_options;
+	};
+
+	class temporary_file
+	{
+	public:
+		explicit temporary_file(std::span<const std::byte> contents)
+		{
+			auto fd = mkstemp(m_path);
+
+			if (fd < 0)
+			{
+				m_path[0] = '\0';
+
+				return;
+			}
+
+			auto written = ::write(fd, contents.data(), size(contents));
+
+			close(fd);
+
+			if (written != static_cast<ssize_t>(size(contents)))
+			{
+				unlink(m_path);
+
+				m_path[0] = '\0';
+			}
+		}
+
+		temporary_file(const temporary_file&) = delete;
+
+		temporary_file& operator=(const temporary_file&) = delete;
+
+		~temporary_file()
+		{
+			if (*m_path)
+			{
+				unlink(m_path);
+			}
+		}
+
+		explicit operator bool() const
+		{
+			return *m_path;
+		}
+
+		const char* path() const
+		{
+			return m_path;
+		}
+
+	private:
+		char m_path[32] = "/tmp/tcg_parser_bench.XXXXXX";
+	};
+
+	// Runs the command line tool on a log with its output going to /dev/null, as the shell would
+	bool run_cli(std::vector<const char*> arguments)
+	{
+		posix_spawn_file_actions_t actions;
+
+		posix_spawn_file_actions_init(&actions);
+		posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+
+		arguments.push_back(nullptr);
+
+		pid_t pid;
+
+		auto error = posix_spawn(
+			&pid,
+			arguments.front(),
+			&actions,
+			nullptr,
+			const_cast<char* const*>(arguments.data()),
+			environ
+		);
+
+		posix_spawn_file_actions_destroy(&actions);
+
+		int status;
+
+		return !error && waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+	}
+
+	void bench_framing(bench_runner& runner, std::span<const std::byte> log, const auto& digest_sizes, auto events)
+	{
+		auto bytes = size(log);
+
+		runner.run("frame/read_event_2_view", events, bytes, [&] {
+			auto input = log;
+
+			while (auto view = tcg_parser::read_event_2_view(input, digest_sizes))
+			{
+				keep(*view);
+			}
+		});
+
+		runner.run("frame/event_framer", events, bytes, [&] {
+			auto input = log;
+
+			tcg_parser::event_framer framer(digest_sizes);
+
+			while (auto view = framer(input))
+			{
+				keep(*view);
+			}
+		});
+
+		runner.run("frame/event_index", events, bytes, [&] {
+			keep(tcg_parser::event_index::build(log, digest_sizes));
+		});
+	}
+
+	void bench_reading(
+		bench_runner& runner,
+		std::span<const std::byte> file,
+		std::span<const std::byte> log,
+		const auto& digest_sizes,
+		auto events
+	)
+	{
+		auto bytes = size(file);
+
+		runner.run("read/span", events, bytes, [&] {
+			tcg_parser::event_framer framer(digest_sizes);
+
+			auto input = log;
+
+			while (auto event = tcg_parser::read_event_2(input, framer))
+			{
+				keep(*event);
+			}
+		});
+
+		std::istringstream stream(std::string(reinterpret_cast<const char*>(log.data()), size(log)));
+
+		runner.run("read/istream", events, bytes, [&] {
+			stream.clear();
+			stream.seekg(0);
+
+			while (auto event = tcg_parser::read_event_2(stream, digest_sizes))
+			{
+				keep(*event);
+			}
+		});
+
+		runner.run("read/filtered", events, bytes, [&] {
+			auto input = log;
+
+			tcg_parser::event_framer framer(digest_sizes);
+			tcg_parser::event_filter filter {
+				.pcr_indices = { 4 },
+				.hash_algs = { tcg_parser::TPM_ALG_SHA256 },
+			};
+
+			while (auto event = tcg_parser::read_event_2(input, framer, filter))
+			{
+				keep(*event);
+			}
+		});
+
+		runner.run("read/visit_events_2", events, bytes, [&] {
+			auto input = log;
+
+			tcg_parser::visit_events_2(input, digest_sizes, [](const auto& view, const auto& payload) {
+				keep(payload);
+			});
+		});
+
+		for (std::size_t chunk_size : { 512, 4096, 65536 })
+		{
+			runner.run(std::format("read/push_parser/{}", chunk_size), events, bytes, [&] {
+				tcg_parser::push_parser parser;
+
+				for (auto input = file; !input.empty(); input = input.subspan(std::min(chunk_size, size(input))))
+				{
+					parser.feed(input.first(std::min(chunk_size, size(input))), [](const auto& event) {
+						keep(event);
+					});
+				}
+			});
+		}
+
+		for (unsigned thread_count = 1; thread_count <= std::thread::hardware_concurrency(); thread_count *= 2)
+		{
+			tcg_parser::parallel_reader reader(thread_count);
+
+			runner.run(std::format("read/parallel_reader/{}", thread_count), events, bytes, [&] {
+				auto input = log;
+
+				keep(reader.read_events_2(input, digest_sizes));
+			});
+		}
+	}
+
+	void bench_payloads(bench_runner& runner, std::span<const std::byte> log, const auto& digest_sizes)
+	{
+		std::map<uint32_t, std::vector<tcg_parser::tcg_pgr_event_2_view>> views_by_type;
+
+		auto input = log;
+
+		tcg_parser::event_framer framer(digest_sizes);
+
+		while (auto view = framer(input))
+		{
+			views_by_type[view->event_type].push_back(*view);
+		}
+
+		for (auto& [event_type, views] : views_by_type)
+		{
+			std::size_t bytes = 0;
+
+			for (auto& view : views)
+			{
+				bytes += size(view.event);
+			}
+
+			auto name = tcg_parser::to_string(event_type);
+
+			runner.run(std::format("decode/{}", name.empty() ? "unknown" : name), size(views), bytes, [&] {
+				for (auto& view : views)
+				{
+					keep(tcg_parser::read_event_payload(view, view.event));
+				}
+			});
+		}
+	}
+
+	void bench_device_paths(bench_runner& runner, std::span<const std::byte> log, const auto& digest_sizes)
+	{
+		std::vector<tcg_parser::device_path_buffer> paths;
+
+		auto input = log;
+
+		while (auto event = tcg_parser::read_event_2(input, digest_sizes))
+		{
+			std::visit(
+				[&](const auto& payload) {
+					using payload_t = std::decay_t<decltype(payload)>;
+
+					if constexpr (std::derived_from<payload_t, tcg_parser::events::uefi_image_load>)
+					{
+						paths.push_back(payload.device_path);
+					}
+				},
+				event->event
+			);
+		}
+
+		std::size_t bytes = 0;
+
+		for (auto& path : paths)
+		{
+			bytes += size(path.bytes());
+		}
+
+		runner.run("device_path/parse", size(paths), bytes, [&] {
+			for (auto& path : paths)
+			{
+				auto bytes = path.bytes();
+
+				keep(tcg_parser::device_path::parse(bytes));
+			}
+		});
+
+		runner.run("device_path/view", size(paths), bytes, [&] {
+			for (auto& path : paths)
+			{
+				for (auto node : path.view())
+				{
+					keep(node);
+				}
+			}
+		});
+
+		runner.run("device_path/to_string", size(paths), bytes, [&] {
+			for (auto& path : paths)
+			{
+				keep(tcg_parser::device_path::to_string(path.view()));
+			}
+		});
+
+		std::vector<std::vector<tcg_parser::device_path_t>> nodes;
+
+		for (auto& path : paths)
+		{
+			nodes.push_back(path.to_vector());
+		}
+
+		std::vector<std::byte> output;
+
+		runner.run("device_path/write", size(paths), bytes, [&] {
+			for (auto& path : nodes)
+			{
+				output.clear();
+
+				tcg_parser::device_path::write(output, path);
+
+				keep(output);
+			}
+		});
+	}
+
+	void bench_hex(bench_runner& runner, std::span<const std::byte> log, const auto& digest_sizes, auto events)
+	{
+		std::vector<std::span<const std::byte>> digests;
+
+		std::size_t bytes = 0;
+
+		auto input = log;
+
+		tcg_parser::event_framer framer(digest_sizes);
+
+		while (auto view = framer(input))
+		{
+			tcg_parser::details::for_each_digest(*view, digest_sizes, [&](uint16_t, std::span<const std::byte> digest) {
+				digests.push_back(digest);
+
+				bytes += size(digest);
+			});
+		}
+
+		auto run = [&](std::string_view name, tcg_parser::details::to_hex_t kernel) {
+			runner.run(name, events, bytes, [&] {
+				char buffer[tcg_parser::digest::max_size * 2];
+
+				for (auto digest : digests)
+				{
+					kernel(digest.data(), size(digest), buffer);
+
+					keep(buffer);
+				}
+			});
+		};
+
+		// The per-byte stream formatting the CLI used before the hex kernels
+		runner.run("hex/iostream", events, bytes, [&] {
+			std::ostringstream stream;
+
+			for (auto digest : digests)
+			{
+				stream.seekp(0);
+
+				for (auto byte : digest)
+				{
+					stream << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(byte);
+				}
+
+				keep(stream);
+			}
+		});
+
+		run("hex/scalar", tcg_parser::details::to_hex_scalar);
+
+#if defined(__x86_64__) || defined(__i386__)
+		if (__builtin_cpu_supports("ssse3"))
+		{
+			run("hex/ssse3", tcg_parser::details::to_hex_ssse3);
+		}
+
+		if (__builtin_cpu_supports("avx2"))
+		{
+			run("hex/avx2", tcg_parser::details::to_hex_avx2);
+		}
+#endif
+	}
+
+	void bench_tools(
+		bench_runner& runner,
+		std::span<const std::byte> file,
+		std::span<const std::byte> log,
+		const auto& digest_sizes,
+		const std::vector<tcg_parser::tcg_pgr_event_2>& events
+	)
+	{
+		auto bytes = size(file);
+
+		runner.run("json", size(events), bytes, [&] {
+			auto input = file;
+
+			auto null = open("/dev/null", O_WRONLY);
+
+			{
+				tcg_parser::buffered_writer writer(null);
+				tcg_parser::json_serializer serializer(writer);
+
+				serializer(*tcg_parser::read_event_1(input));
+
+				tcg_parser::visit_events_2(input, digest_sizes, serializer);
+			}
+
+			close(null);
+		});
+
+		runner.run("cache/write", size(events), bytes, [&] {
+			keep(tcg_parser::write_event_cache(file));
+		});
+
+		if (auto cache_file = tcg_parser::write_event_cache(file))
+		{
+			runner.run("cache/scan", size(events), bytes, [&] {
+				auto cache = tcg_parser::event_cache::load(*cache_file);
+
+				for (std::size_t i = 0; i < cache->size(); i++)
+				{
+					keep(cache->pcr_index(i));
+					keep(cache->digest(i, tcg_parser::TPM_ALG_SHA256));
+				}
+			});
+		}
+
+		tcg_parser::digest_baseline_builder builder;
+
+		// Half of the images are known
+		for (std::size_t i = 0; i < size(events); i += 2)
+		{
+			if (tcg_parser::details::is_boot_services_image(events[i].event_type))
+			{
+				for (auto digest : events[i].digests)
+				{
+					builder.add(digest);
+				}
+			}
+		}
+
+		runner.run("baseline/build", size(events), bytes, [&] {
+			keep(builder.build());
+		});
+
+		auto baseline_file = builder.build();
+
+		if (auto baseline = tcg_parser::digest_baseline::load(baseline_file))
+		{
+			runner.run("baseline/unknown_images", size(events), bytes, [&] {
+				keep(tcg_parser::unknown_images(*baseline, log, digest_sizes));
+			});
+		}
+
+		runner.run("intern", size(events), bytes, [&] {
+			tcg_parser::event_interner interner;
+
+			for (auto& event : events)
+			{
+				keep(interner.intern(event));
+			}
+		});
+
+		// One event in a hundred is removed and another one changes its digests
+		auto changed_events = events;
+
+		for (std::size_t i = 0; i + 1 < size(changed_events); i += 100)
+		{
+			changed_events.erase(begin(changed_events) + i);
+
+			tcg_parser::digest_bank digests;
+
+			for (auto digest : changed_events[i + 1].digests)
+			{
+				std::vector<std::byte> bytes(digest.bytes().begin(), digest.bytes().end());
+
+				bytes[0] = ~bytes[0];
+
+				digests.push_back(digest.hash_alg(), bytes);
+			}
+
+			changed_events[i + 1].digests = digests;
+		}
+
+		runner.run("diff", size(events), bytes, [&] {
+			keep(tcg_parser::diff_events(events, changed_events));
+		});
+	}
+
+	void bench_replay(
+		bench_runner& runner,
+		std::span<const std::byte> file,
+		std::span<const std::byte> log,
+		const auto& digest_sizes,
+		const std::vector<tcg_parser::tcg_pgr_event_2>& events
+	)
+	{
+		// The payloads stand in for the data that firmware measures
+		std::vector<std::span<const std::byte>> payloads;
+
+		std::size_t bytes = 0;
+
+		auto input = log;
+
+		tcg_parser::event_framer framer(digest_sizes);
+
+		while (auto view = framer(input))
+		{
+			payloads.push_back(view->event);
+
+			bytes += size(view->event);
+		}
+
+		auto run = [&](std::string_view name, uint16_t hash_alg, const auto& initial, auto kernel) {
+			runner.run(name, size(payloads), bytes, [&] {
+				std::array<std::byte, tcg_parser::digest::max_size> output;
+				auto value = std::span(output).first(tcg_parser::digest_size(hash_alg));
+
+				for (auto payload : payloads)
+				{
+					tcg_parser::details::sha_hash(initial, kernel, payload, value);
+
+					keep(output);
+				}
+			});
+		};
+
+		using namespace tcg_parser::details;
+
+		run("hash/sha1/scalar", tcg_parser::TPM_ALG_SHA1, sha1_initial, sha1_blocks_scalar);
+		run("hash/sha256/scalar", tcg_parser::TPM_ALG_SHA256, sha256_initial, sha256_blocks_scalar);
+		run("hash/sha512/scalar", tcg_parser::TPM_ALG_SHA512, sha512_initial, sha512_blocks_scalar);
+
+#if defined(__x86_64__) || defined(__i386__)
+		if (__builtin_cpu_supports("sha") && __builtin_cpu_supports("sse4.1"))
+		{
+			run("hash/sha1/sha_ni", tcg_parser::TPM_ALG_SHA1, sha1_initial, sha1_blocks_sha_ni);
+			run("hash/sha256/sha_ni", tcg_parser::TPM_ALG_SHA256, sha256_initial, sha256_blocks_sha_ni);
+		}
+#endif
+
+		runner.run("replay/events", size(events), size(file), [&] {
+			tcg_parser::pcr_replay replay(digest_sizes);
+
+			for (auto& event : events)
+			{
+				replay.extend(event);
+			}
+
+			keep(replay);
+		});
+
+		runner.run("replay/log", size(events), size(file), [&] {
+			keep(tcg_parser::replay_log(file));
+		});
+
+		// The generated digests are random, so every event whose digests cover its data is a mismatch. A copy with
+		// those digests recomputed measures the common case, where the log is fine.
+		std::vector<std::byte> verified_file(file.begin(), file.end());
+
+		auto verified_log = std::span<const std::byte>(verified_file).last(size(log));
+
+		while (auto view = framer(verified_log))
+		{
+			if (!tcg_parser::details::digests_cover_data(view->event_type))
+			{
+				continue;
+			}
+
+			auto data = tcg_parser::details::hashed_data(view->event_type, view->event);
+
+			tcg_parser::details::for_each_digest(*view, digest_sizes, [&](uint16_t hash_alg, auto recorded) {
+				if (data && tcg_parser::can_hash(hash_alg))
+				{
+					auto computed = tcg_parser::hash(hash_alg, *data);
+					auto offset = recorded.data() - verified_file.data();
+
+					std::ranges::copy(computed.bytes(), verified_file.begin() + offset);
+				}
+			});
+		}
+
+		runner.run("verify/digests/valid", size(events), size(file), [&] {
+			keep(tcg_parser::digest_verifier().verify(verified_file));
+		});
+
+		runner.run("verify/digests/mismatched", size(events), size(file), [&] {
+			keep(tcg_parser::digest_verifier().verify(file));
+		});
+
+		// The verifier case: many logs at once, here copies of the one log, replayed one after another and as a batch
+		constexpr std::size_t batch_size = 64;
+
+		std::vector<std::span<const std::byte>> logs(batch_size, file);
+
+		runner.run(
+			"replay/logs/one_by_one",
+			size(events) * batch_size,
+			size(file) * batch_size,
+			[&] {
+				for (auto entry : logs)
+				{
+					keep(tcg_parser::replay_log(entry));
+				}
+			},
+			batch_size
+		);
+
+		runner.run(
+			"replay/logs/batch",
+			size(events) * batch_size,
+			size(file) * batch_size,
+			[&] {
+				keep(tcg_parser::replay_logs(logs));
+			},
+			batch_size
+		);
+
+		// The SHA-256 extend kernels on their own, each extend counted as an event
+		auto run_extend = [&](std::string_view name, sha256_extend_lanes_t kernel, std::size_t lanes) {
+			constexpr std::size_t extends = 1024;
+
+			std::array<std::array<std::byte, 32>, 16> values {};
+			std::array<std::byte*, 16> pcrs;
+			std::array<const std::byte*, 16> digests;
+
+			for (std::size_t lane = 0; lane < 16; lane++)
+			{
+				pcrs[lane] = values[lane].data();
+				digests[lane] = values[(lane + 1) % 16].data();
+			}
+
+			runner.run(name, extends, 0, [&] {
+				for (std::size_t i = 0; i < extends; i += lanes)
+				{
+					kernel(pcrs.data(), digests.data());
+				}
+
+				keep(values);
+			});
+		};
+
+		run_extend("replay/extend/sha256/x1", sha256_extend_x1, 1);
+
+#if defined(__x86_64__) || defined(__i386__)
+		if (__builtin_cpu_supports("avx2"))
+		{
+			run_extend("replay/extend/sha256/avx2_x8", sha256_extend_x8, 8);
+		}
+
+		if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx2"))
+		{
+			run_extend("replay/extend/sha256/avx512_x16", sha256_extend_x16, 16);
+		}
+#endif
+
+		runner.run("replay/checkpoints/build", size(events), size(file), [&] {
+			keep(tcg_parser::replay_checkpoints::build(file));
+		});
+
+		auto checkpoints = tcg_parser::replay_checkpoints::build(file);
+		auto hash_alg = digest_sizes.front().hash_alg;
+
+		// The queries go to the PCR with the most events, at evenly spread points of the log, and count as events
+		std::array<std::size_t, tcg_parser::pcr_count> pcr_events {};
+
+		for (auto& event : events)
+		{
+			if (event.pcr_index < tcg_parser::pcr_count)
+			{
+				pcr_events[event.pcr_index]++;
+			}
+		}
+
+		auto pcr_index = static_cast<uint32_t>(std::ranges::max_element(pcr_events) - begin(pcr_events));
+
+		constexpr std::size_t queries = 64;
+
+		std::vector<tcg_parser::digest> expected;
+
+		for (std::size_t i = 1; i <= queries; i++)
+		{
+			expected.push_back(checkpoints->value_after(hash_alg, pcr_index, size(events) * i / queries));
+		}
+
+		runner.run("replay/checkpoints/pcrs_after", queries, 0, [&] {
+			for (std::size_t i = 1; i <= queries; i++)
+			{
+				keep(checkpoints->pcrs_after(size(events) * i / queries));
+			}
+		});
+
+		runner.run("replay/checkpoints/value_after", queries, 0, [&] {
+			for (std::size_t i = 1; i <= queries; i++)
+			{
+				keep(checkpoints->value_after(hash_alg, pcr_index, size(events) * i / queries));
+			}
+		});
+
+		runner.run("replay/checkpoints/find_value", queries, 0, [&] {
+			for (auto& value : expected)
+			{
+				keep(checkpoints->find_value(hash_alg, pcr_index, value.bytes()));
+			}
+		});
+
+		// What finding the event takes without checkpoints: replaying from the start until the PCR has the value
+		runner.run("replay/find_value/linear", queries, 0, [&] {
+			for (auto& value : expected)
+			{
+				auto input = log;
+
+				tcg_parser::pcr_replay replay(digest_sizes);
+				tcg_parser::event_framer framer(digest_sizes);
+
+				while (replay.value(hash_alg, pcr_index) != value)
+				{
+					replay.extend(*framer(input));
+				}
+
+				keep(replay);
+			}
+		});
+	}
+
+	void bench_writing(
+		bench_runner& runner,
+		std::span<const std::byte> file,
+		const std::vector<tcg_parser::tcg_pgr_event_2>& events
+	)
+	{
+		std::vector<std::byte> output;
+
+		runner.run("write/write_event_2", size(events), size(file), [&] {
+			output.clear();
+
+			for (auto& event : events)
+			{
+				tcg_parser::write_event_2(output, event);
+			}
+
+			keep(output);
+		});
+	}
+
+	void bench_files(bench_runner& runner, std::span<const std::byte> file, std::size_t events)
+	{
+		temporary_file log_file(file);
+
+		if (!log_file)
+		{
+			std::cerr << "Cannot write the log to a temporary file" << std::endl;
+
+			return;
+		}
+
+		runner.run("read/mapped_file", events, size(file), [&] {
+			auto mapping = tcg_parser::mapped_file::open(log_file.path());
+			auto input = mapping->data();
+			auto header = tcg_parser::read_event_1(input);
+
+			tcg_parser::event_framer framer(std::get<tcg_parser::events::efi_spec_id>(header->event).digest_sizes);
+
+			while (auto view = framer(input))
+			{
+				keep(*view);
+			}
+		});
+
+#ifdef TCG_PARSER_CLI
+		if (!run_cli({ TCG_PARSER_CLI, log_file.path() }))
+		{
+			std::cerr << "Cannot run " TCG_PARSER_CLI << std::endl;
+
+			return;
+		}
+
+		runner.run("cli/text", events, size(file), [&] {
+			run_cli({ TCG_PARSER_CLI, log_file.path() });
+		});
+
+		runner.run("cli/json", events, size(file), [&] {
+			run_cli({ TCG_PARSER_CLI, "--json", log_file.path() });
+		});
+#endif
+	}
+
+	// The hostile logs are made from a short log, so that many of them fit in memory at once
+	constexpr std::size_t hostile_log_count = 64;
+	constexpr std::size_t hostile_log_events = 1000;
+
+	std::vector<std::vector<std::byte>> make_hostile_logs(const tcg_parser::log_generator_options& options)
+	{
+		auto short_options = options;
+
+		short_options.event_count = std::min(options.event_count, hostile_log_events);
+
+		auto file = *tcg_parser::generate_log(short_options);
+
+		std::vector<std::vector<std::byte>> logs;
+
+		for (std::size_t i = 0; i < hostile_log_count; i++)
+		{
+			logs.push_back(tcg_parser::generate_hostile_log(file, options.seed * hostile_log_count + i));
+		}
+
+		return logs;
+	}
+
+	// Read a whole log with the default limits, the way a verifier would, and return how many events they read
+	std::size_t read_log(std::span<const std::byte> input)
+	{
+		tcg_parser::parse_budget budget;
+
+		auto header = tcg_parser::read_event_1(input, budget);
+		auto spec_event = header ? std::get_if<tcg_parser::events::efi_spec_id>(&header->event) : nullptr;
+
+		if (!spec_event)
+		{
+			return 0;
+		}
+
+		tcg_parser::event_framer framer(spec_event->digest_sizes);
+
+		std::size_t events = 0;
+
+		while (auto event = tcg_parser::read_event_2(input, framer, budget))
+		{
+			keep(*event);
+
+			events++;
+		}
+
+		return events;
+	}
+
+	std::size_t read_log(std::istream& stream)
+	{
+		tcg_parser::parse_budget budget;
+
+		auto header = tcg_parser::read_event_1(stream, budget);
+		auto spec_event = header ? std::get_if<tcg_parser::events::efi_spec_id>(&header->event) : nullptr;
+
+		if (!spec_event)
+		{
+			return 0;
+		}
+
+		std::size_t events = 0;
+
+		while (auto event = tcg_parser::read_event_2(stream, spec_event->digest_sizes, budget))
+		{
+			keep(*event);
+
+			events++;
+		}
+
+		return events;
+	}
+
+	std::size_t push_log(std::span<const std::byte> input)
+	{
+		tcg_parser::push_parser parser(tcg_parser::parse_limits {});
+
+		std::size_t events = 0;
+
+		parser.feed(input, [&](const auto& event) {
+			keep(event);
+
+			events++;
+		});
+
+		return events;
+	}
+
+	// Fuzzed logs whose size fields ask for up to gigabytes, read through a span, a stream and push_parser. They take
+	// about as long and allocate about as much as the events they hold, which the events per second show.
+	void bench_hostile(bench_runner& runner, const std::vector<std::vector<std::byte>>& logs)
+	{
+		std::size_t events = 0;
+		std::size_t bytes = 0;
+
+		std::vector<std::istringstream> streams;
+
+		for (auto& log : logs)
+		{
+			events += read_log(log);
+			bytes += size(log);
+
+			streams.emplace_back(std::string(reinterpret_cast<const char*>(log.data()), size(log)));
+		}
+
+		runner.run(
+			"hostile/read/span",
+			events,
+			bytes,
+			[&] {
+				for (auto& log : logs)
+				{
+					keep(read_log(log));
+				}
+			},
+			size(logs)
+		);
+
+		runner.run(
+			"hostile/read/istream",
+			events,
+			bytes,
+			[&] {
+				for (auto& stream : streams)
+				{
+					stream.clear();
+					stream.seekg(0);
+
+					keep(read_log(stream));
+				}
+			},
+			size(logs)
+		);
+
+		runner.run(
+			"hostile/push_parser",
+			events,
+			bytes,
+			[&] {
+				for (auto& log : logs)
+				{
+					keep(push_log(log));
+				}
+			},
+			size(logs)
+		);
+	}
+
+	// Checks that the events read from a log are the ones it was written from, that writing them again reproduces the
+	// log, and that encoding the nodes of every device path reproduces the device path
+	bool check_round_trip(
+		std::span<const std::byte> file,
+		const tcg_parser::tcg_pgr_event_1& header,
+		std::span<const tcg_parser::tcg_pgr_event_2> written,
+		std::span<const tcg_parser::tcg_pgr_event_2> events
+	)
+	{
+		if (size(events) != size(written))
+		{
+			std::cerr << std::format("Round trip: wrote {} events, read {}", size(written), size(events)) << std::endl;
+
+			return false;
+		}
+
+		if (auto [mismatch, _] = std::ranges::mismatch(written, events); mismatch != end(written))
+		{
+			auto event = mismatch - begin(written);
+
+			std::cerr << std::format("Round trip: event {} changes when written", event) << std::endl;
+
+			return false;
+		}
+
+		auto output = tcg_parser::write_log(header, events);
+
+		if (!output || !std::ranges::equal(*output, file))
+		{
+			std::cerr << "Round trip: writing the events read from the log does not reproduce it" << std::endl;
+
+			return false;
+		}
+
+		std::vector<std::byte> path_bytes;
+
+		for (std::size_t i = 0; i < size(events); i++)
+		{
+			auto image = std::visit(
+				[](const auto& payload) -> const tcg_parser::events::uefi_image_load* {
+					using payload_t = std::decay_t<decltype(payload)>;
+
+					if constexpr (std::derived_from<payload_t, tcg_parser::events::uefi_image_load>)
+					{
+						return &payload;
+					}
+
+					return nullptr;
+				},
+				events[i].event
+			);
+
+			if (!image)
+			{
+				continue;
+			}
+
+			path_bytes.clear();
+
+			if (!tcg_parser::device_path::write(path_bytes, image->device_path.to_vector())
+				|| !std::ranges::equal(path_bytes, image->device_path.bytes()))
+			{
+				std::cerr << std::format("Round trip: encoding the device path of event {} changes it", i) << std::endl;
+
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	// Device path nodes the generator does not make
+	std::vector<tcg_parser::device_path_t> round_trip_nodes()
+	{
+		using namespace tcg_parser;
+
+		return {
+			device_path::hardware::mmio { .memory_type = 11, .start_address = 0xff000000, .end_address = 0xffffffff },
+			device_path::acpi::extended_acpi { .hid = 0x0a0841d0u, .uid = u"1", .cid = u"PNP0A03" },
+			device_path::messaging::sata { .hba_port = 1, .port_multiplier_port = 0xffff, .logical_unit_number = 0 },
+			device_path::messaging::usb { .parent_port = 2, .interface = 0 },
+			device_path::messaging::lun { .lun = 3 },
+			device_path::media::piwg_firmware_volume { .firmware_volume_name = { 1, 2, 3 } },
+			device_path::media::piwg_firmware_files { .firmware_file_name = { 4, 5, 6 } },
+			device_path::media::relative_offset_range { .starting_offset = 0x1000, .ending_offset = 0x1fff },
+			device_path::unknown { .type = 0x5, .sub_type = 0x1, .length = 12 },
+		};
+	}
+
+	// Events with the payloads the generator does not make
+	std::vector<tcg_parser::tcg_pgr_event_2> round_trip_samples(std::span<const std::byte> device_path)
+	{
+		using namespace tcg_parser;
+
+		events::efi_runtime_services_driver driver;
+
+		driver.device_path = device_path_buffer(device_path);
+
+		std::vector<tcg_pgr_event_2> samples = {
+			{ .event_type = EV_EFI_HCRTM_EVENT, .event = events::efi_hcrtm { std::string("HCRTM") } },
+			{ .event_type = EV_EFI_HCRTM_EVENT, .event = events::efi_hcrtm { events::uefi_blob_1 { 0x1000, 0x20 } } },
+			{
+				.event_type = EV_POST_CODE,
+				.event = events::post_code { events::uefi_blob_2 { "POST CODE", 0xffd00000, 0x300000 } },
+			},
+			{ .event_type = EV_EFI_RUNTIME_SERVICES_DRIVER, .event = driver },
+			{ .event_type = EV_NONHOST_INFO, .event = std::string("\x01\x02") },
+		};
+
+		for (auto& sample : samples)
+		{
+			sample.digests.push_back(TPM_ALG_SHA256, std::array<std::byte, 32>());
+		}
+
+		return samples;
+	}
+
+	bool check_round_trip_samples()
+	{
+		using namespace tcg_parser;
+
+		tcg_pgr_event_1 header {
+			.event_type = EV_NO_ACTION,
+			.event = events::efi_spec_id {
+				.signature = { 'S', 'p', 'e', 'c', ' ', 'I', 'D', ' ', 'E', 'v', 'e', 'n', 't', '0', '3' },
+				.spec_version_major = 2,
+				.uint_n_size = 2,
+				.digest_sizes = { { TPM_ALG_SHA256, 32 } },
+				.vendor_info = "vendor",
+			},
+		};
+
+		auto nodes = round_trip_nodes();
+
+		std::vector<std::byte> path;
+
+		if (!device_path::write(path, nodes) || device_path_view(path).to_vector() != nodes)
+		{
+			std::cerr << "Round trip: the sample device path changes when written" << std::endl;
+
+			return false;
+		}
+
+		auto samples = round_trip_samples(path);
+		auto file = write_log(header, samples);
+
+		if (!file)
+		{
+			std::cerr << "Round trip: cannot write the sample events" << std::endl;
+
+			return false;
+		}
+
+		auto input = std::span<const std::byte>(*file);
+		auto header_read = read_event_1(input);
+
+		if (!header_read || *header_read != header)
+		{
+			std::cerr << "Round trip: the Spec ID event of the samples changes when written" << std::endl;
+
+			return false;
+		}
+
+		std::vector<tcg_pgr_event_2> samples_read;
+
+		while (auto event = read_event_2(input, std::get<events::efi_spec_id>(header.event).digest_sizes))
+		{
+			samples_read.push_back(std::move(*event));
+		}
+
+		return check_round_trip(*file, header, samples, samples_read);
+	}
+
+	// Checks that the events of a cache have the same accessors as those read from the log, including for events that
+	// leave out some of the banks of the spec ID event, which the generator never does
+	bool check_cache_round_trip(
+		const tcg_parser::tcg_pgr_event_1& header,
+		std::span<const tcg_parser::tcg_pgr_event_2> events
+	)
+	{
+		using namespace tcg_parser;
+
+		std::vector<tcg_pgr_event_2> partial(events.begin(), events.begin() + std::min<std::size_t>(size(events), 64));
+
+		for (std::size_t i = 0; i < size(partial); i += 3)
+		{
+			digest_bank digests;
+
+			for (std::size_t bank = 0; bank + 1 < partial[i].digests.size(); bank++)
+			{
+				digests.push_back(partial[i].digests[bank].hash_alg(), partial[i].digests[bank].bytes());
+			}
+
+			partial[i].digests = digests;
+		}
+
+		auto file = write_log(header, partial);
+		auto cache_file = file ? write_event_cache(*file) : std::nullopt;
+		auto cache = cache_file ? event_cache::load(*cache_file) : std::nullopt;
+
+		if (!cache || cache->size() != size(partial))
+		{
+			std::cerr << "Cache round trip: cannot cache a log with missing banks" << std::endl;
+
+			return false;
+		}
+
+		auto input = std::span<const std::byte>(*file);
+		auto header_read = read_event_1(input);
+		auto& digest_sizes = std::get<events::efi_spec_id>(header_read->event).digest_sizes;
+
+		std::size_t i = 0;
+
+		for (; auto event = read_lazy_event_2(input, digest_sizes); i++)
+		{
+			auto cached = (*cache)[i];
+			auto same = cached.pcr_index() == event->pcr_index() && cached.event_type() == event->event_type() &&
+						cached.digests() == event->digests() && std::ranges::equal(cached.data(), event->data());
+
+			for (auto entry : digest_sizes)
+			{
+				same = same && std::ranges::equal(cached.digest(entry.hash_alg), event->digest(entry.hash_alg));
+			}
+
+			if (!same)
+			{
+				std::cerr << std::format("Cache round trip: event {} differs from the one in the log", i) << std::endl;
+
+				return false;
+			}
+		}
+
+		if (i != size(partial))
+		{
+			std::cerr << "Cache round trip: cannot read back a log with missing banks" << std::endl;
+
+			return false;
+		}
+
+		return true;
+	}
+
+	// Checks that replaced events come out of a diff as changed in place, including in long runs of identical events,
+	// where an alignment may remove any of them
+	bool check_diff_locality()
+	{
+		using namespace tcg_parser;
+
+		auto event = [](std::uint8_t byte) {
+			tcg_pgr_event_2 event { .pcr_index = 4, .event_type = EV_IPL };
+			std::array<std::byte, 32> digest {};
+
+			digest[0] = std::byte { byte };
+			event.digests.push_back(TPM_ALG_SHA256, digest);
+
+			return event;
+		};
+
+		auto local = [](const std::vector<event_difference>& differences, std::size_t count) {
+			return size(differences) == count && std::ranges::all_of(differences, [](const auto& difference) {
+					   return difference.change == event_change::changed &&
+							  difference.old_event == difference.new_event;
+				   });
+		};
+
+		std::vector<tcg_pgr_event_2> old_events(4, event(1));
+		auto new_events = old_events;
+
+		new_events[1] = event(2);
+
+		if (!local(diff_events(old_events, new_events), 1))
+		{
+			std::cerr << "Diff: a replaced event is not reported as changed in place" << std::endl;
+
+			return false;
+		}
+
+		old_events.assign(30000, event(1));
+		new_events = old_events;
+
+		std::size_t replaced = 0;
+
+		for (std::size_t i = 17; i < size(new_events); i += 50)
+		{
+			new_events[i] = event(std::uint8_t(2 + i % 3));
+			replaced++;
+		}
+
+		if (!local(diff_events(old_events, new_events), replaced))
+		{
+			std::cerr << std::format("Diff: {} events replaced in a run are not reported as changed in place", replaced)
+					  << std::endl;
+
+			return false;
+		}
+
+		return true;
+	}
+
+	// Checks every hash kernel the CPU can run against the test vectors of FIPS 180-2, of which the longer messages
+	// need a second block for the padding
+	bool check_hash_kernels()
+	{
+		using namespace tcg_parser;
+		using namespace tcg_parser::details;
+
+		struct test_vector
+		{
+			uint16_t hash_alg;
+			std::string_view message;
+			std::string_view digest;
+		};
+
+		constexpr auto short_message = "abc"sv;
+		constexpr auto message_448 = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"sv;
+		constexpr auto message_896 = "abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmnoijklmnopjklmnopq"
+									 "klmnopqrlmnopqrsmnopqrstnopqrstu"sv;
+
+		constexpr test_vector test_vectors[] = {
+			{ TPM_ALG_SHA1, short_message, "a9993e364706816aba3e25717850c26c9cd0d89d" },
+			{ TPM_ALG_SHA1, message_448, "84983e441c3bd26ebaae4aa1f95129e5e54670f1" },
+			{ TPM_ALG_SHA256, short_message, "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad" },
+			{ TPM_ALG_SHA256, message_448, "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1" },
+			{ TPM_ALG_SHA384,
+			  short_message,
+			  "cb00753f45a35e8bb5a03d699ac65007272c32ab0eded1631a8b605a43ff5bed8086072ba1e7cc2358baeca134c825a7" },
+			{ TPM_ALG_SHA384,
+			  message_896,
+			  "09330c33f71147e83d192fc782cd1b4753111b173b3b05d22fa08086e3b0f712fcc7c71a557e2db966c3e9fa91746039" },
+			{ TPM_ALG_SHA512,
+			  short_message,
+			  "ddaf35a193617abacc417349ae20413112e6fa4e89a97ea20a9eeee64b55d39a"
+			  "2192992a274fc1a836ba3c23a3feebbd454d4423643ce80e2a9ac94fa54ca49f" },
+			{ TPM_ALG_SHA512,
+			  message_896,
+			  "8e959b75dae313da8cf4f72814fc143f8f7779c6eb9f7fa17299aeadb6889018"
+			  "501d289e4900f7e4331b99dec4b5433ac7d329eeb6dd26545e96e55b874be909" },
+		};
+
+		using kernels = std::vector<std::pair<std::string_view, sha_blocks_t<uint32_t>>>;
+
+		kernels sha1_kernels = { { "scalar", sha1_blocks_scalar } };
+		kernels sha256_kernels = { { "scalar", sha256_blocks_scalar } };
+
+#if defined(__x86_64__) || defined(__i386__)
+		if (__builtin_cpu_supports("sha") && __builtin_cpu_supports("sse4.1"))
+		{
+			sha1_kernels.emplace_back("sha_ni", sha1_blocks_sha_ni);
+			sha256_kernels.emplace_back("sha_ni", sha256_blocks_sha_ni);
+		}
+#endif
+
+		for (auto [hash_alg, message, expected] : test_vectors)
+		{
+			auto input = std::as_bytes(std::span(message));
+			std::array<std::byte, digest::max_size> output;
+			auto value = std::span(output).first(digest_size(hash_alg));
+
+			auto check = [&](std::string_view kernel) {
+				if (to_hex(value) == expected)
+				{
+					return true;
+				}
+
+				std::cerr << std::format(
+					"Hash: the {} kernel of {} gets the digest of a {} byte message wrong",
+					kernel,
+					hash_alg_name(hash_alg),
+					size(message)
+				) << std::endl;
+
+				return false;
+			};
+
+			switch (hash_alg)
+			{
+			case TPM_ALG_SHA1:
+				for (auto [name, kernel] : sha1_kernels)
+				{
+					sha_hash(sha1_initial, kernel, input, value);
+
+					if (!check(name))
+					{
+						return false;
+					}
+				}
+
+				break;
+			case TPM_ALG_SHA256:
+				for (auto [name, kernel] : sha256_kernels)
+				{
+					sha_hash(sha256_initial, kernel, input, value);
+
+					if (!check(name))
+					{
+						return false;
+					}
+				}
+
+				break;
+			default:
+				auto& initial = hash_alg == TPM_ALG_SHA384 ? sha384_initial : sha512_initial;
+
+				sha_hash(initial, sha512_blocks_scalar, input, value);
+
+				if (!check("scalar"))
+				{
+					return false;
+				}
+			}
+		}
+
+		return true;
+	}
+
+	// Checks the multi-buffer extend kernels against extending one PCR at a time, and a batch replay of the log, of
+	// its halves and of a copy without the header against replaying each of them on its own
+	bool check_batch_replay(std::span<const std::byte> file)
+	{
+		using namespace tcg_parser;
+		using namespace tcg_parser::details;
+
+		std::vector<std::pair<std::string_view, sha256_extend_kernel>> kernels;
+
+#if defined(__x86_64__) || defined(__i386__)
+		if (__builtin_cpu_supports("avx2"))
+		{
+			kernels.emplace_back("avx2_x8", sha256_extend_kernel { sha256_extend_x8, 8 });
+		}
+
+		if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx2"))
+		{
+			kernels.emplace_back("avx512_x16", sha256_extend_kernel { sha256_extend_x16, 16 });
+		}
+#endif
+
+		for (auto [name, kernel] : kernels)
+		{
+			std::array<std::array<std::byte, 32>, 16> values;
+			std::array<std::array<std::byte, 32>, 16> expected;
+			std::array<std::byte*, 16> pcrs;
+			std::array<const std::byte*, 16> digests;
+
+			for (std::size_t lane = 0; lane < 16; lane++)
+			{
+				for (std::size_t i = 0; i < 32; i++)
+				{
+					values[lane][i] = std::byte(lane * 37 + i * 11);
+				}
+
+				pcrs[lane] = values[lane].data();
+				digests[lane] = file.data() + lane * 32;
+			}
+
+			expected = values;
+
+			for (std::size_t lane = 0; lane < 16; lane++)
+			{
+				auto pcr = expected[lane].data();
+
+				sha256_extend_x1(&pcr, &digests[lane]);
+			}
+
+			for (std::size_t lane = 0; lane < 16; lane += kernel.lanes)
+			{
+				kernel.extend(pcrs.data() + lane, digests.data() + lane);
+			}
+
+			if (values != expected)
+			{
+				std::cerr << std::format("Batch replay: the {} kernel gets an extend wrong", name) << std::endl;
+
+				return false;
+			}
+		}
+
+		std::vector<std::span<const std::byte>> logs = {
+			file,
+			file.first(size(file) / 2),
+			file,
+			file.subspan(size(file) / 2),
+		};
+
+		auto replays = replay_logs(logs);
+
+		for (std::size_t i = 0; i < size(logs); i++)
+		{
+			auto expected = replay_log(logs[i]);
+
+			if (expected.has_value() != replays[i].has_value())
+			{
+				std::cerr << std::format("Batch replay: log {} fails in only one of the replays", i) << std::endl;
+
+				return false;
+			}
+
+			for (auto hash_alg : expected ? expected->hash_algs() : std::vector<uint16_t>())
+			{
+				for (uint32_t pcr_index = 0; pcr_index < pcr_count; pcr_index++)
+				{
+					if (expected->value(hash_alg, pcr_index) != replays[i]->value(hash_alg, pcr_index))
+					{
+						std::cerr << std::format(
+							"Batch replay: log {} ends with a different {} PCR {}",
+							i,
+							hash_alg_name(hash_alg),
+							pcr_index
+						) << std::endl;
+
+						return false;
+					}
+				}
+			}
+		}
+
+		return true;
+	}
+
+	// Checks that no hostile log makes a reader allocate much more than the clean log it was made from, which is
+	// bounded by the events it holds rather than by the sizes it claims
+	bool check_hostile_logs(const tcg_parser::log_generator_options& options, const auto& logs)
+	{
+		auto short_options = options;
+
+		short_options.event_count = std::min(options.event_count, hostile_log_events);
+
+		auto file = *tcg_parser::generate_log(short_options);
+
+		// How many bytes reading a log allocates
+		auto measure = [](auto& read, std::span<const std::byte> input) {
+			auto bytes = allocation_bytes.load();
+
+			read(input);
+
+			return allocation_bytes.load() - bytes;
+		};
+
+		auto check = [&](std::string_view name, auto&& read) {
+			auto clean = measure(read, file);
+
+			for (std::size_t i = 0; i < size(logs); i++)
+			{
+				if (auto hostile = measure(read, logs[i]); hostile > 2 * clean)
+				{
+					std::cerr << std::format(
+						"Hostile logs: log {} makes the {} reader allocate {} bytes, where the clean log takes {}",
+						i,
+						name,
+						hostile,
+						clean
+					) << std::endl;
+
+					return false;
+				}
+			}
+
+			return true;
+		};
+
+		auto read_span = [](std::span<const std::byte> input) {
+			return read_log(input);
+		};
+
+		auto read_stream = [](std::span<const std::byte> input) {
+			std::istringstream stream(std::string(reinterpret_cast<const char*>(input.data()), size(input)));
+
+			return read_log(stream);
+		};
+
+		return check("span", read_span) && check("istream", read_stream) && check("push_parser", push_log);
+	}
+
+	bool parse_number(std::string_view text, auto& value)
+	{
+		auto [end, error] = std::from_chars(text.data(), text.data() + size(text), value);
+
+		return error == std::errc() && end == text.data() + size(text);
+	}
+
+	// Calls function with every element of a comma separated list and stops at the first one it rejects
+	bool parse_list(std::string_view text, auto&& function)
+	{
+		while (!text.empty())
+		{
+			auto comma = text.find(',');
+
+			if (!function(text.substr(0, comma)))
+			{
+				return false;
+			}
+
+			text = comma == std::string_view::npos ? std::string_view() : text.substr(comma + 1);
+		}
+
+		return true;
+	}
+
+	bool parse_hash_alg(std::string_view name, uint16_t& hash_alg)
+	{
+		using namespace tcg_parser;
+
+		for (auto candidate : { TPM_ALG_SHA1, TPM_ALG_SHA256, TPM_ALG_SHA384, TPM_ALG_SHA512, TPM_ALG_SM3_256 })
+		{
+			if (name == hash_alg_name(candidate))
+			{
+				hash_alg = candidate;
+
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	bool parse_mix_entry(std::string_view entry, auto& mix)
+	{
+		auto equals = entry.find('=');
+
+		if (equals == std::string_view::npos)
+		{
+			return false;
+		}
+
+		for (auto kind : tcg_parser::synthetic_events)
+		{
+			if (entry.substr(0, equals) == tcg_parser::synthetic_event_name(kind))
+			{
+				unsigned weight;
+
+				if (!parse_number(entry.substr(equals + 1), weight))
+				{
+					return false;
+				}
+
+				mix.emplace_back(kind, weight);
+
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	bool parse_options(std::span<char*> arguments, bench_options& options)
+	{
+		for (std::size_t i = 0; i + 1 < size(arguments); i += 2)
+		{
+			auto name = std::string_view(arguments[i]);
+			auto value = std::string_view(arguments[i + 1]);
+
+			auto parsed = [&] {
+				if (name == "--events")
+				{
+					return parse_number(value, options.log.event_count);
+				}
+
+				if (name == "--seed")
+				{
+					return parse_number(value, options.log.seed);
+				}
+
+				if (name == "--depth")
+				{
+					return parse_number(value, options.log.device_path_depth);
+				}
+
+				if (name == "--banks")
+				{
+					options.log.hash_algs.clear();
+
+					return parse_list(value, [&](std::string_view bank) {
+						uint16_t hash_alg = 0;
+
+						if (!parse_hash_alg(bank, hash_alg))
+						{
+							return false;
+						}
+
+						options.log.hash_algs.push_back(hash_alg);
+
+						return true;
+					});
+				}
+
+				if (name == "--mix")
+				{
+					options.log.mix.clear();
+
+					return parse_list(value, [&](std::string_view entry) {
+						return parse_mix_entry(entry, options.log.mix);
+					});
+				}
+
+				if (name == "--min-time")
+				{
+					double seconds;
+
+					if (!parse_number(value, seconds))
+					{
+						return false;
+					}
+
+					options.min_time = std::chrono::duration<double>(seconds);
+
+					return true;
+				}
+
+				if (name == "--filter")
+				{
+					options.filter = value;
+
+					return true;
+				}
+
+				return false;
+			}();
+
+			if (!parsed)
+			{
+				return false;
+			}
+		}
+
+		return size(arguments) % 2 == 0;
+	}
+} // namespace
+
+int main(int argc, char** argv)
+{
+	bench_options options;
+
+	if (!parse_options(std::span(argv + 1, argc - 1), options))
+	{
+		std::cerr << "Usage: " << argv[0]
+				  << " [--events N] [--banks sha1,sha256,...] [--depth N] [--mix kind=weight,...] [--seed N]"
+					 " [--min-time SECONDS] [--filter NAME]"
+				  << std::endl;
+
+		return 1;
+	}
+
+	auto synthetic = tcg_parser::generate_events(options.log);
+	auto file = *tcg_parser::write_log(synthetic.header, synthetic.events);
+
+	auto log = std::span<const std::byte>(file);
+	auto header = tcg_parser::read_event_1(log);
+	auto spec_event = std::get_if<tcg_parser::events::efi_spec_id>(&header->event);
+
+	if (!spec_event)
+	{
+		std::cerr << "The generated log has no Spec ID event" << std::endl;
+
+		return 1;
+	}
+
+	auto& digest_sizes = spec_event->digest_sizes;
+
+	std::vector<tcg_parser::tcg_pgr_event_2> events;
+
+	for (auto input = log; auto event = tcg_parser::read_event_2(input, digest_sizes);)
+	{
+		events.push_back(std::move(*event));
+	}
+
+	auto hostile_logs = make_hostile_logs(options.log);
+
+	if (!check_round_trip(file, synthetic.header, synthetic.events, events) || !check_round_trip_samples() ||
+		!check_cache_round_trip(synthetic.header, synthetic.events) || !check_diff_locality() ||
+		!check_hash_kernels() || !check_batch_replay(file) || !check_hostile_logs(options.log, hostile_logs))
+	{
+		return 1;
+	}
+
+	std::string banks;
+
+	for (auto& digest_size : digest_sizes)
+	{
+		banks += std::format("{}{}", banks.empty() ? "" : ",", tcg_parser::hash_alg_name(digest_size.hash_alg));
+	}
+
+	std::cout << std::format(
+		"{} events, {} bytes, banks {}, device path depth {}, seed {}\n\n",
+		size(events),
+		size(file),
+		banks,
+		options.log.device_path_depth,
+		options.log.seed
+	);
+
+	bench_runner runner(options);
+
+	bench_framing(runner, log, digest_sizes, size(events));
+	bench_reading(runner, file, log, digest_sizes, size(events));
+	bench_payloads(runner, log, digest_sizes);
+	bench_device_paths(runner, log, digest_sizes);
+	bench_hex(runner, log, digest_sizes, size(events));
+	bench_tools(runner, file, log, digest_sizes, events);
+	bench_replay(runner, file, log, digest_sizes, events);
+	bench_writing(runner, file, events);
+	bench_files(runner, file, size(events));
+	bench_hostile(runner, hostile_logs);
+
+	return 0;
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <concepts>
+#include <cstddef>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include <unistd.h>
+
+namespace tcg_parser
+{
+	// Collects output in a large buffer and hands it to a file descriptor only once the buffer is full.
+	// Also works as a container for std::back_inserter, so std::format_to can write into it.
+	class buffered_writer
+	{
+	public:
+		using value_type = char;
+
+		explicit buffered_writer(int fd, std::size_t capacity = 1024 * 1024)
+			: m_fd(fd)
+			, m_buffer(std::max<std::size_t>(capacity, 64))
+		{
+		}
+
+		buffered_writer(const buffered_writer&) = delete;
+
+		buffered_writer& operator=(const buffered_writer&) = delete;
+
+		~buffered_writer()
+		{
+			flush();
+		}
+
+		void push_back(char character)
+		{
+			if (m_size == size(m_buffer))
+			{
+				flush();
+			}
+
+			m_buffer[m_size++] = character;
+		}
+
+		void write(std::string_view text)
+		{
+			if (size(text) > size(m_buffer) - m_size)
+			{
+				flush();
+
+				// Too large to be worth copying
+				if (size(text) >= size(m_buffer))
+				{
+					write_all(text.data(), size(text));
+
+					return;
+				}
+			}
+
+			std::ranges::copy(text, m_buffer.data() + m_size);
+
+			m_size += size(text);
+		}
+
+		void write(std::integral auto value)
+		{
+			auto buffer = prepare(24);
+			auto [end, error] = std::to_chars(buffer.data(), buffer.data() + size(buffer), value);
+
+			commit(end - buffer.data());
+		}
+
+		// Returns room for at least count characters, which must not exceed the capacity of the writer.
+		// Whatever was written there becomes part of the output with commit().
+		std::span<char> prepare(std::size_t count)
+		{
+			if (count > size(m_buffer) - m_size)
+			{
+				flush();
+			}
+
+			return std::span(m_buffer).subspan(m_size);
+		}
+
+		void commit(std::size_t count)
+		{
+			m_size += count;
+		}
+
+		std::size_t capacity() const
+		{
+			return size(m_buffer);
+		}
+
+		// Returns false once any write to the file descriptor has failed
+		bool flush()
+		{
+			write_all(m_buffer.data(), m_size);
+
+			m_size = 0;
+
+			return m_good;
+		}
+
+		bool good() const
+		{
+			return m_good;
+		}
+
+	private:
+		void write_all(const char* data, std::size_t count)
+		{
+			while (m_good && count)
+			{
+				auto written = ::write(m_fd, data, count);
+
+				if (written < 0)
+				{
+					if (errno != EINTR)
+					{
+						m_good = false;
+					}
+
+					continue;
+				}
+
+				data += written;
+				count -= written;
+			}
+		}
+
+		int m_fd;
+		std::vector<char> m_buffer;
+		std::size_t m_size = 0;
+		bool m_good = true;
+	};
+} // namespace tcg_parser
@@ -1,16 +1,21 @@
 #pragma once
 
 #include <array>
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <format>
 #include <iostream>
 #include <istream>
-#include <numeric>
+#include <iterator>
+#include <span>
 #include <string>
+#include <type_traits>
 #include <variant>
 #include <vector>
 
 #include "acpi.hpp"
+#include "reader.hpp"
 
 namespace tcg_parser
 {
@@ -23,6 +28,8 @@ namespace tcg_parser
 			uint8_t type;
 			uint8_t sub_type;
 			uint16_t length;
+
+			bool operator==(const unknown&) const = default;
 		};
 
 		namespace hardware
@@ -31,6 +38,8 @@ namespace tcg_parser
 			{
 				uint8_t function;
 				uint8_t device;
+
+				bool operator==(const pci&) const = default;
 			};
 
 			struct mmio
@@ -38,6 +47,8 @@ namespace tcg_parser
 				uint32_t memory_type;
 				uint64_t start_address;
 				uint64_t end_address;
+
+				bool operator==(const mmio&) const = default;
 			};
 		} // namespace hardware
 
@@ -47,6 +58,8 @@ namespace tcg_parser
 			{
 				uint32_t hid;
 				uint32_t uid;
+
+				bool operator==(const acpi&) const = default;
 			};
 
 			struct extended_acpi
@@ -54,6 +67,8 @@ namespace tcg_parser
 				std::variant<uint32_t, std::u16string> hid;
 				std::variant<uint32_t, std::u16string> uid;
 				std::variant<uint32_t, std::u16string> cid;
+
+				bool operator==(const extended_acpi&) const = default;
 			};
 		} // namespace acpi
 
@@ -63,6 +78,8 @@ namespace tcg_parser
 			{
 				uint32_t namespace_identifier;
 				std::array<uint8_t, 8> extended_unique_identifier;
+
+				bool operator==(const nvme_namespace&) const = default;
 			};
 
 			struct sata
@@ -70,17 +87,23 @@ namespace tcg_parser
 				uint16_t hba_port;
 				uint16_t port_multiplier_port;
 				uint16_t logical_unit_number;
+
+				bool operator==(const sata&) const = default;
 			};
 
 			struct lun
 			{
 				uint8_t lun;
+
+				bool operator==(const struct lun&) const = default;
 			};
 
 			struct usb
 			{
 				uint8_t parent_port;
 				uint8_t interface;
+
+				bool operator==(const usb&) const = default;
 			};
 		} // namespace messaging
 
@@ -94,21 +117,29 @@ namespace tcg_parser
 				std::array<uint8_t, 16> signature;
 				uint8_t partition_format;
 				uint8_t signature_type;
+
+				bool operator==(const hard_drive&) const = default;
 			};
 
 			struct file
 			{
 				std::u16string path;
+
+				bool operator==(const file&) const = default;
 			};
 
 			struct piwg_firmware_volume
 			{
 				std::array<uint8_t, 16> firmware_volume_name;
+
+				bool operator==(const piwg_firmware_volume&) const = default;
 			};
 
 			struct piwg_firmware_files
 			{
 				std::array<uint8_t, 16> firmware_file_name;
+
+				bool operator==(const piwg_firmware_files&) const = default;
 			};
 
 			struct relative_offset_range
@@ -116,6 +147,8 @@ namespace tcg_parser
 				uint32_t reserved;
 				uint64_t starting_offset;
 				uint64_t ending_offset;
+
+				bool operator==(const relative_offset_range&) const = default;
 			};
 		} // namespace media
 	}	  // namespace device_path
@@ -142,15 +175,15 @@ namespace tcg_parser
 	{
 		namespace details
 		{
-			std::u16string read_string(std::istream& stream)
+			std::u16string read_string(auto& reader)
 			{
 				std::u16string storage;
 
-				while (stream.good())
+				while (reader.good())
 				{
 					char16_t character;
 
-					if (stream.read(reinterpret_cast<char*>(&character), sizeof(character)); !character)
+					if (!reader.read(&character, sizeof(character)) || !character)
 					{
 						break;
 					}
@@ -160,50 +193,34 @@ namespace tcg_parser
 
 				return storage;
 			}
-		} // namespace details
-
-		std::vector<device_path_t> parse(std::istream& stream)
-		{
-			unknown header;
-
-			std::vector<device_path_t> paths;
 
-			while (stream.good())
+			template <typename T>
+			device_path_t read_struct(const unknown& header, std::span<const std::byte> body)
 			{
-				if (stream.read(reinterpret_cast<char*>(&header), sizeof(header)); !stream.good())
+				T path;
+
+				if (size(body) < sizeof(path))
 				{
-					return paths;
+					return header;
 				}
 
+				std::memcpy(&path, body.data(), sizeof(path));
+
+				return path;
+			}
+
+			// Decodes a single node from its header and the body that follows it
+			device_path_t read_node(const unknown& header, std::span<const std::byte> body)
+			{
 				switch (header.type)
 				{
 				case 0x1: // Hardware device path
 					switch (header.sub_type)
 					{
-					case 0x1: {
-						hardware::pci path;
-
-						if (stream.read(reinterpret_cast<char*>(&path), sizeof(path)); !stream.good())
-						{
-							return paths;
-						}
-
-						paths.push_back(path);
-
-						continue;
-					}
-					case 0x3: { // Memory Mapped
-						hardware::mmio path;
-
-						if (stream.read(reinterpret_cast<char*>(&path), sizeof(path)); !stream.good())
-						{
-							return paths;
-						}
-
-						paths.push_back(path);
-
-						continue;
-					}
+					case 0x1:
+						return read_struct<hardware::pci>(header, body);
+					case 0x3: // Memory Mapped
+						return read_struct<hardware::mmio>(header, body);
 					}
 
 					break;
@@ -211,16 +228,7 @@ namespace tcg_parser
 					switch (header.sub_type)
 					{
 					case 0x1: // ACPI device path
-						acpi::acpi path;
-
-						if (stream.read(reinterpret_cast<char*>(&path), sizeof(path)); !stream.good())
-						{
-							return paths;
-						}
-
-						paths.push_back(path);
-
-						continue;
+						return read_struct<acpi::acpi>(header, body);
 					case 0x2: // Expanded ACPI device path
 					{
 #pragma pack(push, 1)
@@ -234,9 +242,11 @@ namespace tcg_parser
 
 #pragma pack(pop)
 
-						if (stream.read(reinterpret_cast<char*>(&block), sizeof(block)); !stream.good())
+						tcg_parser::details::span_reader reader(body);
+
+						if (!reader.read(&block, sizeof(block)))
 						{
-							return paths;
+							return header;
 						}
 
 						acpi::extended_acpi path = {
@@ -245,24 +255,22 @@ namespace tcg_parser
 							.cid = block.cid,
 						};
 
-						if (auto hidstr = details::read_string(stream); !empty(hidstr))
+						if (auto hidstr = read_string(reader); !empty(hidstr))
 						{
 							path.hid = hidstr;
 						}
 
-						if (auto uidstr = details::read_string(stream); !empty(uidstr))
+						if (auto uidstr = read_string(reader); !empty(uidstr))
 						{
 							path.uid = uidstr;
 						}
 
-						if (auto cidstr = details::read_string(stream); !empty(cidstr))
+						if (auto cidstr = read_string(reader); !empty(cidstr))
 						{
 							path.cid = cidstr;
 						}
 
-						paths.push_back(path);
-
-						continue;
+						return path;
 					}
 					case 0x3: // _ADR device path
 						break;
@@ -274,352 +282,603 @@ namespace tcg_parser
 				case 0x3: // Messaging device path
 					switch (header.sub_type)
 					{
-					case 0x5: { // USB
-						messaging::usb path;
-
-						if (stream.read(reinterpret_cast<char*>(&path), sizeof(path)); !stream.good())
-						{
-							return paths;
-						}
+					case 0x5: // USB
+						return read_struct<messaging::usb>(header, body);
+					case 0x11: // LUN
+						return read_struct<messaging::lun>(header, body);
+					case 0x12: // SATA
+						return read_struct<messaging::sata>(header, body);
+					case 0x17: // NVM Express Namespace
+						return read_struct<messaging::nvme_namespace>(header, body);
+					}
 
-						paths.push_back(path);
+					break;
+				case 0x4: // Media device path
+					switch (header.sub_type)
+					{
+					case 0x1: // Hard drive
+						return read_struct<media::hard_drive>(header, body);
+					case 0x2: // CD-ROM
+						break;
+					case 0x3: // Vendor
+						break;
+					case 0x4: { // File path
+						tcg_parser::details::span_reader reader(body);
 
-						continue;
+						return media::file {
+							.path = read_string(reader),
+						};
 					}
-					case 0x11: { // LUN
-						messaging::lun path;
+					case 0x5: // Media protocol
+						break;
+					case 0x6: // PIWG firmware files
+						return read_struct<media::piwg_firmware_files>(header, body);
+					case 0x7: // PIWG firmware volume
+						return read_struct<media::piwg_firmware_volume>(header, body);
+					case 0x8: // Relative offset range
+						return read_struct<media::relative_offset_range>(header, body);
+					}
+					break;
+				case 0x5: // BIOS boot specification device path
+					break;
+				}
 
-						if (stream.read(reinterpret_cast<char*>(&path), sizeof(path)); !stream.good())
-						{
-							return paths;
-						}
+				return header;
+			}
 
-						paths.push_back(path);
+			bool is_end(const unknown& header)
+			{
+				return header.type == 0x7f && header.sub_type == 0xFF;
+			}
 
-						continue;
-					}
-					case 0x12: { // SATA
-						messaging::sata path;
+			std::vector<device_path_t> parse(auto& reader)
+			{
+				unknown header;
 
-						if (stream.read(reinterpret_cast<char*>(&path), sizeof(path)); !stream.good())
-						{
-							return paths;
-						}
+				std::vector<device_path_t> paths;
+				std::vector<std::byte> body;
 
-						paths.push_back(path);
+				while (reader.good())
+				{
+					if (!reader.read(&header, sizeof(header)) || is_end(header) || header.length < sizeof(header))
+					{
+						return paths;
+					}
+
+					body.resize(header.length - sizeof(header));
 
-						continue;
+					if (!reader.read(body.data(), size(body)))
+					{
+						return paths;
 					}
-					case 0x17: { // NVM Express Namespace
-						messaging::nvme_namespace path;
 
-						if (stream.read(reinterpret_cast<char*>(&path), sizeof(path)); !stream.good())
-						{
-							return paths;
-						}
+					paths.push_back(read_node(header, body));
+				}
 
-						paths.push_back(path);
+				return paths;
+			}
+		} // namespace details
 
-						continue;
-					}
-					}
+		std::vector<device_path_t> parse(std::istream& stream)
+		{
+			tcg_parser::details::stream_reader reader(stream);
 
-					break;
-				case 0x4: // Media device path
-					switch (header.sub_type)
-					{
-					case 0x1: // Hard drive
-						media::hard_drive path;
+			return details::parse(reader);
+		}
 
-						if (stream.read(reinterpret_cast<char*>(&path), sizeof(path)); !stream.good())
-						{
-							return paths;
-						}
+		std::vector<device_path_t> parse(std::span<const std::byte>& input)
+		{
+			tcg_parser::details::span_reader reader(input);
 
-						paths.push_back(path);
+			auto paths = details::parse(reader);
 
-						continue;
-					case 0x2: // CD-ROM
-						break;
-					case 0x3: // Vendor
-						break;
-					case 0x4: { // File path
-						media::file path {
-							.path = details::read_string(stream),
-						};
+			input = reader.remaining();
 
-						if (!stream.good())
-						{
-							return paths;
-						}
+			return paths;
+		}
+	} // namespace device_path
 
-						paths.push_back(path);
+	// Iterates over the nodes of a device path stored in a log, decoding each node only when it is dereferenced.
+	// Iteration ends at the end of the path, or at the first node whose length does not fit in the input.
+	class device_path_view
+	{
+	public:
+		class iterator
+		{
+		public:
+			using iterator_category = std::forward_iterator_tag;
+			using value_type = device_path_t;
+			using difference_type = std::ptrdiff_t;
+			using pointer = void;
+			using reference = device_path_t;
 
-						continue;
-					}
-					case 0x5: // Media protocol
-						break;
-					case 0x6: { // PIWG firmware files
-						media::piwg_firmware_files path;
+			iterator() = default;
 
-						if (stream.read(reinterpret_cast<char*>(&path), sizeof(path)); !stream.good())
-						{
-							return paths;
-						}
+			explicit iterator(std::span<const std::byte> input)
+				: m_input(input)
+			{
+				find_node();
+			}
 
-						paths.push_back(path);
+			device_path_t operator*() const
+			{
+				return device_path::details::read_node(header(), m_node.subspan(sizeof(device_path::unknown)));
+			}
 
-						continue;
-					}
-					case 0x7: { // PIWG firmware volume
-						media::piwg_firmware_volume path;
+			device_path::unknown header() const
+			{
+				device_path::unknown header;
 
-						if (stream.read(reinterpret_cast<char*>(&path), sizeof(path)); !stream.good())
-						{
-							return paths;
-						}
+				std::memcpy(&header, m_node.data(), sizeof(header));
 
-						paths.push_back(path);
+				return header;
+			}
 
-						continue;
-					}
-					case 0x8: { // Relative offset range
-						media::relative_offset_range path;
+			// The raw bytes of the node, including its header
+			std::span<const std::byte> node() const
+			{
+				return m_node;
+			}
 
-						if (stream.read(reinterpret_cast<char*>(&path), sizeof(path)); !stream.good())
-						{
-							return paths;
-						}
+			iterator& operator++()
+			{
+				m_input = m_input.subspan(size(m_node));
 
-						paths.push_back(path);
+				find_node();
 
-						continue;
-					}
-					}
-					break;
-				case 0x5: // BIOS boot specification device path
-					break;
-				case 0x7f: // End of hardware device path
-					if (header.sub_type == 0xFF)
-					{
-						return paths;
-					}
-					break;
+				return *this;
+			}
+
+			iterator operator++(int)
+			{
+				auto result = *this;
+
+				++*this;
+
+				return result;
+			}
+
+			bool operator==(const iterator& other) const
+			{
+				return m_node.data() == other.m_node.data();
+			}
+
+		private:
+			void find_node()
+			{
+				device_path::unknown header;
+
+				if (size(m_input) < sizeof(header))
+				{
+					m_node = {};
+
+					return;
 				}
 
-				paths.push_back(header);
+				std::memcpy(&header, m_input.data(), sizeof(header));
 
-				if (stream.seekg(header.length - sizeof(header), std::ios::cur); !stream.good())
+				if (device_path::details::is_end(header) || header.length < sizeof(header) ||
+					header.length > size(m_input))
 				{
-					return paths;
+					m_node = {};
+
+					return;
 				}
+
+				m_node = m_input.first(header.length);
 			}
 
-			return paths;
-		}
+			std::span<const std::byte> m_input;
+			std::span<const std::byte> m_node;
+		};
 
-		std::string to_string(const device_path::unknown& path)
+		device_path_view() = default;
+
+		explicit device_path_view(std::span<const std::byte> bytes)
+			: m_bytes(bytes)
 		{
-			return std::format("\\Unknown({:x}, {:x})", path.type, path.sub_type);
 		}
 
-		std::string to_string(const device_path::hardware::pci& path)
+		iterator begin() const
 		{
-			return std::format("\\Pci(0x{:x}, 0x{:x})", path.device, path.function);
+			return iterator(m_bytes);
 		}
 
-		std::string to_string(const device_path::hardware::mmio& path)
+		iterator end() const
 		{
-			return std::format("\\MemoryMapped({}, 0x{:x}, 0x{:x})", path.memory_type, path.start_address, path.end_address);
+			return iterator();
 		}
 
-		std::string to_string(const device_path::acpi::acpi& path)
+		bool empty() const
 		{
-			switch (path.hid)
-			{
-			case EFIDP_ACPI_PCI_ROOT_HID:
-				return std::format("\\PciRoot(0x{:x})", path.uid);
-			case EFIDP_ACPI_CONTAINER_0A05_HID:
-			case EFIDP_ACPI_CONTAINER_0A06_HID:
-				return "\\AcpiContainer()";
-			case EFIDP_ACPI_PCIE_ROOT_HID:
-				return std::format("\\PcieRoot(0x{:x})", path.uid);
-			case EFIDP_ACPI_EC_HID:
-				return "\\EmbeddedController()";
-			case EFIDP_ACPI_FLOPPY_HID:
-				return std::format("\\Floppy(0x{:x})", path.uid);
-			case EFIDP_ACPI_KEYBOARD_HID:
-				return std::format("\\Keyboard(0x{:x})", path.uid);
-			case EFIDP_ACPI_SERIAL_HID:
-				return std::format("\\Serial(0x{:x})", path.uid);
-			default:
-				return std::format("\\Acpi(0x{:8x},0x{:x})", path.hid, path.uid);
-			}
+			return begin() == end();
 		}
 
-		std::string to_string(const device_path::acpi::extended_acpi& path)
+		std::span<const std::byte> bytes() const
 		{
-			return "\\AcpiExp()";
+			return m_bytes;
 		}
 
-		std::string to_string(const device_path::messaging::nvme_namespace& path)
+		std::vector<device_path_t> to_vector() const
 		{
-			return std::format(
-				"\\NVMe(0x{:x}, {:02X}-{:02X}-{:02X}-{:02X}-{:02X}-{:02X}-{:02X}-{:02X})",
-				path.namespace_identifier,
-				path.extended_unique_identifier[0],
-				path.extended_unique_identifier[1],
-				path.extended_unique_identifier[2],
-				path.extended_unique_identifier[3],
-				path.extended_unique_identifier[4],
-				path.extended_unique_identifier[5],
-				path.extended_unique_identifier[6],
-				path.extended_unique_identifier[7]
-			);
+			return std::vector<device_path_t>(begin(), end());
 		}
 
-		std::string to_string(const device_path::messaging::sata& path)
+	private:
+		std::span<const std::byte> m_bytes;
+	};
+
+	// Owns the raw bytes of a device path, and decodes them the same way as device_path_view
+	class device_path_buffer
+	{
+	public:
+		device_path_buffer() = default;
+
+		explicit device_path_buffer(std::span<const std::byte> bytes)
+			: m_bytes(bytes.begin(), bytes.end())
 		{
-			return std::format("\\Sata({}, {}, {})", path.hba_port, path.port_multiplier_port, path.logical_unit_number);
 		}
 
-		std::string to_string(const device_path::messaging::lun& path)
+		device_path_view view() const
 		{
-			return std::format("\\Unit({})", path.lun);
+			return device_path_view(m_bytes);
 		}
 
-		std::string to_string(const device_path::messaging::usb& path)
+		operator device_path_view() const
 		{
-			return std::format("\\USB({}, {})", path.parent_port, path.interface);
+			return view();
 		}
 
-		std::string to_string(const media::file& path)
+		device_path_view::iterator begin() const
 		{
-			std::string target;
+			return view().begin();
+		}
 
-			std::transform(begin(path.path), end(path.path), back_inserter(target), [](auto character) {
-				return static_cast<char>(character);
-			});
+		device_path_view::iterator end() const
+		{
+			return view().end();
+		}
 
-			return target;
+		bool empty() const
+		{
+			return view().empty();
 		}
 
-		std::string to_string(const media::piwg_firmware_volume& path)
+		std::span<const std::byte> bytes() const
 		{
-			return std::format(
-				"\\FvVol({{{:02X}{:02X}{:02X}{:02X}-{:02X}{:02X}-{:02X}{:02X}-{:02X}{:02X}-{:02X}{:02X}{:02X}{:02X}{:"
-				"02X}{:02X}}})",
-				path.firmware_volume_name[0],
-				path.firmware_volume_name[1],
-				path.firmware_volume_name[2],
-				path.firmware_volume_name[3],
-				path.firmware_volume_name[4],
-				path.firmware_volume_name[5],
-				path.firmware_volume_name[6],
-				path.firmware_volume_name[7],
-				path.firmware_volume_name[8],
-				path.firmware_volume_name[9],
-				path.firmware_volume_name[10],
-				path.firmware_volume_name[11],
-				path.firmware_volume_name[12],
-				path.firmware_volume_name[13],
-				path.firmware_volume_name[14],
-				path.firmware_volume_name[15]
-			);
+			return m_bytes;
 		}
 
-		std::string to_string(const media::piwg_firmware_files& path)
+		std::vector<device_path_t> to_vector() const
 		{
-			return std::format(
-				"\\FvFile({{{:02X}{:02X}{:02X}{:02X}-{:02X}{:02X}-{:02X}{:02X}-{:02X}{:02X}-{:02X}{:02X}{:02X}{:02X}{:"
-				"02X}{:02X}}})",
-				path.firmware_file_name[0],
-				path.firmware_file_name[1],
-				path.firmware_file_name[2],
-				path.firmware_file_name[3],
-				path.firmware_file_name[4],
-				path.firmware_file_name[5],
-				path.firmware_file_name[6],
-				path.firmware_file_name[7],
-				path.firmware_file_name[8],
-				path.firmware_file_name[9],
-				path.firmware_file_name[10],
-				path.firmware_file_name[11],
-				path.firmware_file_name[12],
-				path.firmware_file_name[13],
-				path.firmware_file_name[14],
-				path.firmware_file_name[15]
-			);
+			return view().to_vector();
 		}
 
-		std::string to_string(const media::hard_drive& path)
+		bool operator==(const device_path_buffer& other) const = default;
+
+	private:
+		std::vector<std::byte> m_bytes;
+	};
+
+	namespace device_path
+	{
+		namespace details
 		{
-			switch (path.signature_type)
-			{
-			case 1: // MBR
-				return std::format(
-					"\\HD({},MBR,0x{:x},0x{:x},0x{:x})",
-					path.partition_number,
-					*reinterpret_cast<const uint32_t*>(path.signature.data()),
-					path.partition_start,
-					path.partition_size
+			auto format(auto out, const unknown& path)
+			{
+				return std::format_to(out, "\\Unknown({:x}, {:x})", path.type, path.sub_type);
+			}
+
+			auto format(auto out, const hardware::pci& path)
+			{
+				return std::format_to(out, "\\Pci(0x{:x}, 0x{:x})", path.device, path.function);
+			}
+
+			auto format(auto out, const hardware::mmio& path)
+			{
+				return std::format_to(
+					out,
+					"\\MemoryMapped({}, 0x{:x}, 0x{:x})",
+					path.memory_type,
+					path.start_address,
+					path.end_address
 				);
-			case 2: // GPT
-				return std::format(
-					"\\HD({},GPT,{{{:02X}{:02X}{:02X}{:02X}-{:02X}{:02X}-{:02X}{:02X}-{:02X}{:02X}-{:"
-					"02X}{:02X}{:02X}{:02X}{:02X}{:02X}}},0x{:"
-					"x},0x{:x})",
-					path.partition_number,
-					path.signature[0],
-					path.signature[1],
-					path.signature[2],
-					path.signature[3],
-					path.signature[4],
-					path.signature[5],
-					path.signature[6],
-					path.signature[7],
-					path.signature[8],
-					path.signature[9],
-					path.signature[10],
-					path.signature[11],
-					path.signature[12],
-					path.signature[13],
-					path.signature[14],
-					path.signature[15],
-					path.partition_start,
-					path.partition_size
+			}
+
+			auto format(auto out, const acpi::acpi& path)
+			{
+				switch (path.hid)
+				{
+				case EFIDP_ACPI_PCI_ROOT_HID:
+					return std::format_to(out, "\\PciRoot(0x{:x})", path.uid);
+				case EFIDP_ACPI_CONTAINER_0A05_HID:
+				case EFIDP_ACPI_CONTAINER_0A06_HID:
+					return std::format_to(out, "\\AcpiContainer()");
+				case EFIDP_ACPI_PCIE_ROOT_HID:
+					return std::format_to(out, "\\PcieRoot(0x{:x})", path.uid);
+				case EFIDP_ACPI_EC_HID:
+					return std::format_to(out, "\\EmbeddedController()");
+				case EFIDP_ACPI_FLOPPY_HID:
+					return std::format_to(out, "\\Floppy(0x{:x})", path.uid);
+				case EFIDP_ACPI_KEYBOARD_HID:
+					return std::format_to(out, "\\Keyboard(0x{:x})", path.uid);
+				case EFIDP_ACPI_SERIAL_HID:
+					return std::format_to(out, "\\Serial(0x{:x})", path.uid);
+				default:
+					return std::format_to(out, "\\Acpi(0x{:8x},0x{:x})", path.hid, path.uid);
+				}
+			}
+
+			auto format(auto out, const acpi::extended_acpi& path)
+			{
+				return std::format_to(out, "\\AcpiExp()");
+			}
+
+			auto format(auto out, const messaging::nvme_namespace& path)
+			{
+				return std::format_to(
+					out,
+					"\\NVMe(0x{:x}, {:02X}-{:02X}-{:02X}-{:02X}-{:02X}-{:02X}-{:02X}-{:02X})",
+					path.namespace_identifier,
+					path.extended_unique_identifier[0],
+					path.extended_unique_identifier[1],
+					path.extended_unique_identifier[2],
+					path.extended_unique_identifier[3],
+					path.extended_unique_identifier[4],
+					path.extended_unique_identifier[5],
+					path.extended_unique_identifier[6],
+					path.extended_unique_identifier[7]
 				);
-			default:
-				return std::format(
-					"\\HD({},{},{:x},{:x}",
-					path.partition_number,
-					path.signature_type,
-					path.partition_start,
-					path.partition_size
+			}
+
+			auto format(auto out, const messaging::sata& path)
+			{
+				return std::format_to(
+					out,
+					"\\Sata({}, {}, {})",
+					path.hba_port,
+					path.port_multiplier_port,
+					path.logical_unit_number
 				);
 			}
-		}
 
-		std::string to_string(const media::relative_offset_range& path)
+			auto format(auto out, const messaging::lun& path)
+			{
+				return std::format_to(out, "\\Unit({})", path.lun);
+			}
+
+			auto format(auto out, const messaging::usb& path)
+			{
+				return std::format_to(out, "\\USB({}, {})", path.parent_port, path.interface);
+			}
+
+			auto format(auto out, const media::file& path)
+			{
+				for (auto character : path.path)
+				{
+					*out++ = static_cast<char>(character);
+				}
+
+				return out;
+			}
+
+			auto format(auto out, const media::piwg_firmware_volume& path)
+			{
+				return std::format_to(
+					out,
+					"\\FvVol({{{:02X}{:02X}{:02X}{:02X}-{:02X}{:02X}-{:02X}{:02X}-{:02X}{:02X}-{:02X}{:02X}{:02X}{:02X}"
+					"{:02X}{:02X}}})",
+					path.firmware_volume_name[0],
+					path.firmware_volume_name[1],
+					path.firmware_volume_name[2],
+					path.firmware_volume_name[3],
+					path.firmware_volume_name[4],
+					path.firmware_volume_name[5],
+					path.firmware_volume_name[6],
+					path.firmware_volume_name[7],
+					path.firmware_volume_name[8],
+					path.firmware_volume_name[9],
+					path.firmware_volume_name[10],
+					path.firmware_volume_name[11],
+					path.firmware_volume_name[12],
+					path.firmware_volume_name[13],
+					path.firmware_volume_name[14],
+					path.firmware_volume_name[15]
+				);
+			}
+
+			auto format(auto out, const media::piwg_firmware_files& path)
+			{
+				return std::format_to(
+					out,
+					"\\FvFile({{{:02X}{:02X}{:02X}{:02X}-{:02X}{:02X}-{:02X}{:02X}-{:02X}{:02X}-{:02X}{:02X}{:02X}"
+					"{:02X}{:02X}{:02X}}})",
+					path.firmware_file_name[0],
+					path.firmware_file_name[1],
+					path.firmware_file_name[2],
+					path.firmware_file_name[3],
+					path.firmware_file_name[4],
+					path.firmware_file_name[5],
+					path.firmware_file_name[6],
+					path.firmware_file_name[7],
+					path.firmware_file_name[8],
+					path.firmware_file_name[9],
+					path.firmware_file_name[10],
+					path.firmware_file_name[11],
+					path.firmware_file_name[12],
+					path.firmware_file_name[13],
+					path.firmware_file_name[14],
+					path.firmware_file_name[15]
+				);
+			}
+
+			auto format(auto out, const media::hard_drive& path)
+			{
+				switch (path.signature_type)
+				{
+				case 1: // MBR
+					return std::format_to(
+						out,
+						"\\HD({},MBR,0x{:x},0x{:x},0x{:x})",
+						path.partition_number,
+						*reinterpret_cast<const uint32_t*>(path.signature.data()),
+						path.partition_start,
+						path.partition_size
+					);
+				case 2: // GPT
+					return std::format_to(
+						out,
+						"\\HD({},GPT,{{{:02X}{:02X}{:02X}{:02X}-{:02X}{:02X}-{:02X}{:02X}-{:02X}{:02X}-{:"
+						"02X}{:02X}{:02X}{:02X}{:02X}{:02X}}},0x{:"
+						"x},0x{:x})",
+						path.partition_number,
+						path.signature[0],
+						path.signature[1],
+						path.signature[2],
+						path.signature[3],
+						path.signature[4],
+						path.signature[5],
+						path.signature[6],
+						path.signature[7],
+						path.signature[8],
+						path.signature[9],
+						path.signature[10],
+						path.signature[11],
+						path.signature[12],
+						path.signature[13],
+						path.signature[14],
+						path.signature[15],
+						path.partition_start,
+						path.partition_size
+					);
+				default:
+					return std::format_to(
+						out,
+						"\\HD({},{},{:x},{:x}",
+						path.partition_number,
+						path.signature_type,
+						path.partition_start,
+						path.partition_size
+					);
+				}
+			}
+
+			auto format(auto out, const media::relative_offset_range& path)
+			{
+				return std::format_to(out, "\\Offset(0x{:x}, 0x{:x})", path.starting_offset, path.ending_offset);
+			}
+		} // namespace details
+
+		template <typename T, typename Variant>
+		struct is_alternative;
+
+		template <typename T, typename... Alternatives>
+		struct is_alternative<T, std::variant<Alternatives...>> : std::disjunction<std::is_same<T, Alternatives>...>
 		{
-			return std::format("\\Offset(0x{:x}, 0x{:x})", path.starting_offset, path.ending_offset);
-		}
+		};
 
-		std::string to_string(const device_path_t& path)
+		template <typename T>
+		concept node = is_alternative<T, device_path_t>::value;
+	} // namespace device_path
+} // namespace tcg_parser
+
+template <tcg_parser::device_path::node T>
+struct std::formatter<T, char>
+{
+	constexpr auto parse(std::format_parse_context& context)
+	{
+		return context.begin();
+	}
+
+	auto format(const T& path, std::format_context& context) const
+	{
+		return tcg_parser::device_path::details::format(context.out(), path);
+	}
+};
+
+template <>
+struct std::formatter<tcg_parser::device_path_t, char>
+{
+	constexpr auto parse(std::format_parse_context& context)
+	{
+		return context.begin();
+	}
+
+	auto format(const tcg_parser::device_path_t& path, std::format_context& context) const
+	{
+		return std::visit(
+			[&](auto&& path) {
+				return tcg_parser::device_path::details::format(context.out(), path);
+			},
+			path
+		);
+	}
+};
+
+template <>
+struct std::formatter<tcg_parser::device_path_view, char>
+{
+	constexpr auto parse(std::format_parse_context& context)
+	{
+		return context.begin();
+	}
+
+	auto format(tcg_parser::device_path_view paths, std::format_context& context) const
+	{
+		auto out = context.out();
+
+		for (auto path : paths)
 		{
-			return std::visit(
-				[](auto&& path) {
-					return to_string(path);
+			out = std::visit(
+				[&](auto&& path) {
+					return tcg_parser::device_path::details::format(out, path);
 				},
 				path
 			);
 		}
 
+		return out;
+	}
+};
+
+template <>
+struct std::formatter<tcg_parser::device_path_buffer, char> : std::formatter<tcg_parser::device_path_view, char>
+{
+	auto format(const tcg_parser::device_path_buffer& paths, std::format_context& context) const
+	{
+		return std::formatter<tcg_parser::device_path_view, char>::format(paths, context);
+	}
+};
+
+namespace tcg_parser
+{
+	namespace device_path
+	{
+		std::string to_string(const node auto& path)
+		{
+			return std::format("{}", path);
+		}
+
+		std::string to_string(const device_path_t& path)
+		{
+			return std::format("{}", path);
+		}
+
 		std::string to_string(const std::vector<device_path_t>& paths)
 		{
-			return std::accumulate(begin(paths), end(paths), std::string(), [](auto string, auto path) {
-				return string + to_string(path);
-			});
+			std::string string;
+
+			for (auto& path : paths)
+			{
+				std::format_to(back_inserter(string), "{}", path);
+			}
+
+			return string;
+		}
+
+		std::string to_string(device_path_view paths)
+		{
+			return std::format("{}", paths);
 		}
 	} // namespace device_path
 } // namespace tcg_parser
@@ -0,0 +1,605 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <unordered_set>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "tcg_parser.hpp"
+
+namespace tcg_parser
+{
+	enum class event_change
+	{
+		inserted,
+		removed,
+		// Same PCR index and event type, but different digests
+		changed,
+	};
+
+	// Events are numbered from the first event after the spec ID event, as in event_index. An inserted event has no
+	// old event; old_event is the old event it was inserted in front of. Likewise new_event of a removed event is
+	// the new event it would have been in front of.
+	struct event_difference
+	{
+		event_change change;
+		std::size_t old_event;
+		std::size_t new_event;
+	};
+
+	namespace details
+	{
+		struct diff_key
+		{
+			std::size_t hash;
+			uint32_t pcr_index;
+			uint32_t event_type;
+
+			bool operator==(const diff_key& other) const = default;
+		};
+
+		std::size_t hash_combine(std::size_t hash, std::size_t value)
+		{
+			return hash ^ (value + 0x9e3779b97f4a7c15 + (hash << 6) + (hash >> 2));
+		}
+
+		std::size_t hash_digest(std::span<const std::byte> digest)
+		{
+			auto bytes = std::string_view(reinterpret_cast<const char*>(digest.data()), size(digest));
+
+			return std::hash<std::string_view>()(bytes);
+		}
+
+		// Aligns two sequences of keys with Myers' algorithm in linear space: the middle snake of the edit graph is
+		// found by searching from both ends at once, and the halves on either side of it are aligned recursively.
+		// Keys with equal hashes are only treated as equal if equal(old, new) agrees.
+		template <typename Equal>
+		class key_aligner
+		{
+		public:
+			key_aligner(std::span<const diff_key> old_keys, std::span<const diff_key> new_keys, const Equal& equal)
+				: m_old(old_keys)
+				, m_new(new_keys)
+				, m_equal(equal)
+			{
+			}
+
+			// Returns, for each old key, whether it is kept, and the same for each new key
+			std::pair<std::vector<bool>, std::vector<bool>> align()
+			{
+				m_old_kept.assign(size(m_old), false);
+				m_new_kept.assign(size(m_new), false);
+
+				align(0, size(m_old), 0, size(m_new));
+
+				return { std::move(m_old_kept), std::move(m_new_kept) };
+			}
+
+		private:
+			bool same(std::size_t old_key, std::size_t new_key) const
+			{
+				return m_old[old_key] == m_new[new_key] && m_equal(old_key, new_key);
+			}
+
+			void keep(std::size_t old_key, std::size_t new_key)
+			{
+				m_old_kept[old_key] = true;
+				m_new_kept[new_key] = true;
+			}
+
+			void align(std::size_t old_begin, std::size_t old_end, std::size_t new_begin, std::size_t new_end)
+			{
+				while (old_begin < old_end && new_begin < new_end && same(old_begin, new_begin))
+				{
+					keep(old_begin++, new_begin++);
+				}
+
+				while (old_begin < old_end && new_begin < new_end && same(old_end - 1, new_end - 1))
+				{
+					keep(--old_end, --new_end);
+				}
+
+				if (old_begin == old_end || new_begin == new_end)
+				{
+					return;
+				}
+
+				auto [old_split, new_split] = bisect(old_begin, old_end, new_begin, new_end);
+
+				align(old_begin, old_split, new_begin, new_split);
+				align(old_split, old_end, new_split, new_end);
+			}
+
+			// Returns a point on the middle snake, relative to the start of the whole sequences
+			std::pair<std::size_t, std::size_t> bisect(
+				std::size_t old_begin,
+				std::size_t old_end,
+				std::size_t new_begin,
+				std::size_t new_end
+			)
+			{
+				auto old_size = static_cast<std::ptrdiff_t>(old_end - old_begin);
+				auto new_size = static_cast<std::ptrdiff_t>(new_end - new_begin);
+				auto max_d = (old_size + new_size + 1) / 2;
+				auto offset = max_d;
+				auto delta = old_size - new_size;
+				auto front = (delta % 2) != 0;
+
+				// Furthest reaching x on each diagonal, searching forwards and backwards
+				m_forward.assign(2 * max_d + 2, -1);
+				m_backward.assign(2 * max_d + 2, -1);
+				m_forward[offset + 1] = 0;
+				m_backward[offset + 1] = 0;
+
+				std::ptrdiff_t forward_start = 0, forward_end = 0, backward_start = 0, backward_end = 0;
+
+				for (std::ptrdiff_t d = 0; d < max_d; d++)
+				{
+					for (auto k = -d + forward_start; k <= d - forward_end; k += 2)
+					{
+						auto index = offset + k;
+						auto x = (k == -d || (k != d && m_forward[index - 1] < m_forward[index + 1]))
+									 ? m_forward[index + 1]
+									 : m_forward[index - 1] + 1;
+						auto y = x - k;
+
+						while (x < old_size && y < new_size && same(old_begin + x, new_begin + y))
+						{
+							x++;
+							y++;
+						}
+
+						m_forward[index] = x;
+
+						if (x > old_size)
+						{
+							forward_end += 2;
+						}
+						else if (y > new_size)
+						{
+							forward_start += 2;
+						}
+						else if (front)
+						{
+							auto backward_index = offset + delta - k;
+
+							if (backward_index >= 0 && backward_index < std::ssize(m_backward) &&
+								m_backward[backward_index] != -1 && x >= old_size - m_backward[backward_index])
+							{
+								return { old_begin + x, new_begin + y };
+							}
+						}
+					}
+
+					for (auto k = -d + backward_start; k <= d - backward_end; k += 2)
+					{
+						auto index = offset + k;
+						auto x = (k == -d || (k != d && m_backward[index - 1] < m_backward[index + 1]))
+									 ? m_backward[index + 1]
+									 : m_backward[index - 1] + 1;
+						auto y = x - k;
+
+						while (x < old_size && y < new_size && same(old_end - x - 1, new_end - y - 1))
+						{
+							x++;
+							y++;
+						}
+
+						m_backward[index] = x;
+
+						if (x > old_size)
+						{
+							backward_end += 2;
+						}
+						else if (y > new_size)
+						{
+							backward_start += 2;
+						}
+						else if (!front)
+						{
+							auto forward_index = offset + delta - k;
+
+							if (forward_index >= 0 && forward_index < std::ssize(m_forward) &&
+								m_forward[forward_index] != -1)
+							{
+								auto forward_x = m_forward[forward_index];
+								auto forward_y = offset + forward_x - forward_index;
+
+								if (forward_x >= old_size - x)
+								{
+									return { old_begin + forward_x, new_begin + forward_y };
+								}
+							}
+						}
+					}
+				}
+
+				// Nothing in common, so any split works
+				return { old_begin, new_end };
+			}
+
+			std::span<const diff_key> m_old;
+			std::span<const diff_key> m_new;
+			const Equal& m_equal;
+			std::vector<bool> m_old_kept;
+			std::vector<bool> m_new_kept;
+			std::vector<std::ptrdiff_t> m_forward;
+			std::vector<std::ptrdiff_t> m_backward;
+		};
+
+		// Turns an alignment into differences. Within each run of events that are not kept on either side, removed
+		// and inserted events with the same PCR index and event type are paired up, in order, as changed events.
+		std::vector<event_difference> differences(
+			std::span<const diff_key> old_keys,
+			std::span<const diff_key> new_keys,
+			const std::vector<bool>& old_kept,
+			const std::vector<bool>& new_kept
+		)
+		{
+			std::vector<event_difference> differences;
+
+			std::size_t old_event = 0;
+			std::size_t new_event = 0;
+
+			while (old_event < size(old_keys) || new_event < size(new_keys))
+			{
+				if (old_event < size(old_keys) && new_event < size(new_keys) && old_kept[old_event] &&
+					new_kept[new_event])
+				{
+					old_event++;
+					new_event++;
+
+					continue;
+				}
+
+				auto old_begin = old_event;
+				auto new_begin = new_event;
+
+				while (old_event < size(old_keys) && !old_kept[old_event])
+				{
+					old_event++;
+				}
+
+				while (new_event < size(new_keys) && !new_kept[new_event])
+				{
+					new_event++;
+				}
+
+				auto inserted = new_begin;
+
+				for (auto removed = old_begin; removed < old_event; removed++)
+				{
+					auto match = inserted;
+
+					while (match < new_event && (old_keys[removed].pcr_index != new_keys[match].pcr_index ||
+												 old_keys[removed].event_type != new_keys[match].event_type))
+					{
+						match++;
+					}
+
+					if (match == new_event)
+					{
+						differences.push_back({ event_change::removed, removed, inserted });
+
+						continue;
+					}
+
+					for (; inserted < match; inserted++)
+					{
+						differences.push_back({ event_change::inserted, removed, inserted });
+					}
+
+					differences.push_back({ event_change::changed, removed, inserted++ });
+				}
+
+				for (; inserted < new_event; inserted++)
+				{
+					differences.push_back({ event_change::inserted, old_event, inserted });
+				}
+			}
+
+			return differences;
+		}
+
+		// Among the alignments with the fewest differences, Myers' algorithm may remove any of a run of identical keys,
+		// such as those at the end of the run, far from the inserted keys that replace them. Identical keys can trade
+		// places without changing the events that are kept, so within each run of them, the removed keys are moved
+		// next to inserted keys with the same PCR index and event type on the other side, where they pair up as
+		// changed events. same(key, other_key) compares a key with one of the other side.
+		void gather_removed_keys(
+			std::span<const diff_key> keys,
+			std::vector<bool>& kept,
+			std::span<const diff_key> other_keys,
+			const std::vector<bool>& other_kept,
+			const auto& same
+		)
+		{
+			// The other key each kept key is aligned with, and for each position, that of the first kept key from it on
+			std::vector<std::size_t> partners(size(keys));
+			std::vector<std::size_t> following(size(keys) + 1, size(other_keys));
+
+			for (std::size_t key = 0, other = 0; key < size(keys); key++)
+			{
+				if (kept[key])
+				{
+					while (!other_kept[other])
+					{
+						other++;
+					}
+
+					partners[key] = other++;
+				}
+			}
+
+			for (auto key = size(keys); key-- > 0;)
+			{
+				following[key] = kept[key] ? partners[key] : following[key + 1];
+			}
+
+			std::vector<std::size_t> run_partners;
+			std::vector<std::size_t> removed;
+
+			// One past the other key of the last kept key before the run
+			std::size_t previous = 0;
+
+			for (std::size_t begin = 0, end = 0; begin < size(keys); begin = end)
+			{
+				while (end < size(keys) && keys[end] == keys[begin])
+				{
+					end++;
+				}
+
+				run_partners.clear();
+
+				for (auto key = begin; key < end; key++)
+				{
+					if (kept[key])
+					{
+						run_partners.push_back(partners[key]);
+					}
+				}
+
+				auto removable = (end - begin) - size(run_partners);
+
+				// How many removed keys go in front of each kept key of the run, and after the last one
+				removed.assign(size(run_partners) + 1, 0);
+
+				for (std::size_t gap = 0; gap <= size(run_partners) && removable; gap++)
+				{
+					auto first = gap == 0 ? previous : run_partners[gap - 1] + 1;
+					auto last = gap == size(run_partners) ? following[end] : run_partners[gap];
+
+					for (auto other = first; other < last && removable; other++)
+					{
+						if (!other_kept[other] && other_keys[other].pcr_index == keys[begin].pcr_index &&
+							other_keys[other].event_type == keys[begin].event_type)
+						{
+							removed[gap]++;
+							removable--;
+						}
+					}
+				}
+
+				if (!run_partners.empty() && removable < (end - begin) - size(run_partners))
+				{
+					removed.back() += removable;
+
+					// Identical hashes are not proof of identical keys, so every new pairing is checked
+					auto valid = true;
+
+					for (std::size_t gap = 0, key = begin; gap < size(run_partners) && valid; gap++)
+					{
+						key += removed[gap];
+						valid = same(key++, run_partners[gap]);
+					}
+
+					for (std::size_t gap = 0, key = begin; valid && gap <= size(run_partners); gap++)
+					{
+						for (auto count = removed[gap]; count > 0; count--)
+						{
+							kept[key++] = false;
+						}
+
+						if (gap < size(run_partners))
+						{
+							kept[key++] = true;
+						}
+					}
+				}
+
+				if (!run_partners.empty())
+				{
+					previous = run_partners.back() + 1;
+				}
+			}
+		}
+
+		// Returns the positions of the keys to align: those whose hash also occurs in the other sequence, and the first
+		// of each run of keys whose hash does not
+		std::vector<std::size_t> alignment_keys(std::span<const diff_key> keys, std::span<const diff_key> other_keys)
+		{
+			std::unordered_set<std::size_t> other_hashes;
+
+			other_hashes.reserve(size(other_keys));
+
+			for (auto& key : other_keys)
+			{
+				other_hashes.insert(key.hash);
+			}
+
+			std::vector<std::size_t> positions;
+
+			for (std::size_t position = 0; position < size(keys); position++)
+			{
+				if (other_hashes.contains(keys[position].hash) || position == 0 ||
+					other_hashes.contains(keys[position - 1].hash))
+				{
+					positions.push_back(position);
+				}
+			}
+
+			return positions;
+		}
+
+		std::vector<event_difference> diff_keys(
+			std::span<const diff_key> old_keys,
+			std::span<const diff_key> new_keys,
+			const auto& equal
+		)
+		{
+			// Keys that occur on one side only can never be kept. Each run of them is aligned as its first key alone,
+			// which equals nothing on the other side, so that unrelated stretches of the logs cost no more than one
+			// key, while the keys around them stay where they are and replaced events still line up as changed.
+			auto old_positions = alignment_keys(old_keys, new_keys);
+			auto new_positions = alignment_keys(new_keys, old_keys);
+
+			std::vector<diff_key> old_aligned;
+			std::vector<diff_key> new_aligned;
+
+			for (auto position : old_positions)
+			{
+				old_aligned.push_back(old_keys[position]);
+			}
+
+			for (auto position : new_positions)
+			{
+				new_aligned.push_back(new_keys[position]);
+			}
+
+			auto aligned_equal = [&](std::size_t old_key, std::size_t new_key) {
+				return equal(old_positions[old_key], new_positions[new_key]);
+			};
+
+			auto [old_aligned_kept, new_aligned_kept] =
+				key_aligner(std::span<const diff_key>(old_aligned), new_aligned, aligned_equal).align();
+
+			std::vector<bool> old_kept(size(old_keys));
+			std::vector<bool> new_kept(size(new_keys));
+
+			for (std::size_t key = 0; key < size(old_positions); key++)
+			{
+				old_kept[old_positions[key]] = old_aligned_kept[key];
+			}
+
+			for (std::size_t key = 0; key < size(new_positions); key++)
+			{
+				new_kept[new_positions[key]] = new_aligned_kept[key];
+			}
+
+			auto same = [&](std::size_t old_key, std::size_t new_key) {
+				return old_keys[old_key] == new_keys[new_key] && equal(old_key, new_key);
+			};
+
+			gather_removed_keys(old_keys, old_kept, new_keys, new_kept, same);
+			gather_removed_keys(new_keys, new_kept, old_keys, old_kept, [&](std::size_t new_key, std::size_t old_key) {
+				return same(old_key, new_key);
+			});
+
+			return differences(old_keys, new_keys, old_kept, new_kept);
+		}
+	} // namespace details
+
+	// Aligns two logs by PCR index, event type and digests, and reports the events that were inserted, removed or
+	// changed between them. Payloads are not compared.
+	std::vector<event_difference> diff_events(
+		std::span<const tcg_pgr_event_2> old_events,
+		std::span<const tcg_pgr_event_2> new_events
+	)
+	{
+		auto keys = [](std::span<const tcg_pgr_event_2> events) {
+			std::vector<details::diff_key> keys;
+
+			keys.reserve(size(events));
+
+			for (auto& event : events)
+			{
+				std::size_t hash = details::hash_combine(event.pcr_index, event.event_type);
+
+				for (auto digest : event.digests)
+				{
+					hash = details::hash_combine(hash, digest.hash_alg());
+					hash = details::hash_combine(hash, details::hash_digest(digest.bytes()));
+				}
+
+				keys.push_back({ hash, event.pcr_index, event.event_type });
+			}
+
+			return keys;
+		};
+
+		auto same_digests = [&](std::size_t old_event, std::size_t new_event) {
+			return old_events[old_event].digests == new_events[new_event].digests;
+		};
+
+		return details::diff_keys(keys(old_events), keys(new_events), same_digests);
+	}
+
+	// Same as above, but reads the logs directly and never decodes any payloads. Fails if either log does not start
+	// with a spec ID event.
+	std::optional<std::vector<event_difference>> diff_events(
+		std::span<const std::byte> old_log,
+		std::span<const std::byte> new_log
+	)
+	{
+		struct log
+		{
+			std::vector<details::diff_key> keys;
+			// The digests of each event as they appear in the log, including their algorithm IDs
+			std::vector<std::span<const std::byte>> digests;
+		};
+
+		auto read = [](std::span<const std::byte> input) -> std::optional<log> {
+			auto header = read_event_1(input);
+
+			if (!header)
+			{
+				return {};
+			}
+
+			auto spec_event = std::get_if<events::efi_spec_id>(&header->event);
+
+			if (!spec_event)
+			{
+				return {};
+			}
+
+			log log;
+
+			event_framer framer(spec_event->digest_sizes);
+
+			while (auto view = framer(input))
+			{
+				auto hash = details::hash_combine(view->pcr_index, view->event_type);
+
+				hash = details::hash_combine(hash, details::hash_digest(view->digests));
+
+				log.keys.push_back({ hash, view->pcr_index, view->event_type });
+				log.digests.push_back(view->digests);
+			}
+
+			return log;
+		};
+
+		auto old_events = read(old_log);
+		auto new_events = read(new_log);
+
+		if (!old_events || !new_events)
+		{
+			return {};
+		}
+
+		auto same_digests = [&](std::size_t old_event, std::size_t new_event) {
+			return std::ranges::equal(old_events->digests[old_event], new_events->digests[new_event]);
+		};
+
+		return details::diff_keys(old_events->keys, new_events->keys, same_digests);
+	}
+} // namespace tcg_parser
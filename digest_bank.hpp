@@ -0,0 +1,285 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace tcg_parser
+{
+	// A digest that lives elsewhere, such as in a digest_bank, together with the algorithm that produced it
+	class digest_view
+	{
+	public:
+		digest_view() = default;
+
+		digest_view(uint16_t hash_alg, std::span<const std::byte> value)
+			: m_hash_alg(hash_alg)
+			, m_value(value)
+		{
+		}
+
+		uint16_t hash_alg() const
+		{
+			return m_hash_alg;
+		}
+
+		std::size_t size() const
+		{
+			return m_value.size();
+		}
+
+		const uint8_t* data() const
+		{
+			return reinterpret_cast<const uint8_t*>(m_value.data());
+		}
+
+		const uint8_t* begin() const
+		{
+			return data();
+		}
+
+		const uint8_t* end() const
+		{
+			return data() + size();
+		}
+
+		std::span<const std::byte> bytes() const
+		{
+			return m_value;
+		}
+
+		bool operator==(const digest_view& other) const
+		{
+			return m_hash_alg == other.m_hash_alg && std::ranges::equal(m_value, other.m_value);
+		}
+
+	private:
+		uint16_t m_hash_alg = 0;
+		std::span<const std::byte> m_value;
+	};
+
+	// A digest stored inline together with the algorithm that produced it
+	class digest
+	{
+	public:
+		static constexpr std::size_t max_size = 64;
+
+		digest() = default;
+
+		digest(uint16_t hash_alg, std::span<const std::byte> value)
+			: m_hash_alg(hash_alg)
+			, m_size(static_cast<uint8_t>(value.size()))
+		{
+			std::memcpy(m_value.data(), value.data(), m_size);
+		}
+
+		explicit digest(digest_view view)
+			: digest(view.hash_alg(), view.bytes())
+		{
+		}
+
+		uint16_t hash_alg() const
+		{
+			return m_hash_alg;
+		}
+
+		std::size_t size() const
+		{
+			return m_size;
+		}
+
+		const uint8_t* data() const
+		{
+			return m_value.data();
+		}
+
+		const uint8_t* begin() const
+		{
+			return m_value.data();
+		}
+
+		const uint8_t* end() const
+		{
+			return m_value.data() + m_size;
+		}
+
+		std::span<const std::byte> bytes() const
+		{
+			return std::as_bytes(std::span(m_value.data(), m_size));
+		}
+
+		operator digest_view() const
+		{
+			return digest_view(m_hash_alg, bytes());
+		}
+
+		bool operator==(const digest& other) const
+		{
+			return m_hash_alg == other.m_hash_alg && std::ranges::equal(*this, other);
+		}
+
+	private:
+		uint16_t m_hash_alg = 0;
+		uint8_t m_size = 0;
+		std::array<uint8_t, max_size> m_value;
+	};
+
+	// The digests of one event, one per hash algorithm. They are packed one after the other, each as its hash_alg,
+	// its size and its bytes, so that a bank takes only the space of the digests it holds. Up to inline_size bytes
+	// are stored in the bank itself, which is enough for a SHA-1 and a SHA-256 digest; larger banks move to the heap.
+	class digest_bank
+	{
+		static constexpr std::size_t record_header_size = sizeof(uint16_t) + sizeof(uint8_t);
+
+	public:
+		static constexpr std::size_t inline_size = 64;
+
+		class iterator
+		{
+		public:
+			using value_type = digest_view;
+			using difference_type = std::ptrdiff_t;
+
+			iterator() = default;
+
+			explicit iterator(const std::byte* record)
+				: m_record(record)
+			{
+			}
+
+			digest_view operator*() const
+			{
+				uint16_t hash_alg;
+
+				std::memcpy(&hash_alg, m_record, sizeof(hash_alg));
+
+				return digest_view(hash_alg, std::span(m_record + record_header_size, value_size()));
+			}
+
+			iterator& operator++()
+			{
+				m_record += record_header_size + value_size();
+
+				return *this;
+			}
+
+			iterator operator++(int)
+			{
+				auto previous = *this;
+
+				++*this;
+
+				return previous;
+			}
+
+			bool operator==(const iterator& other) const = default;
+
+		private:
+			std::size_t value_size() const
+			{
+				return std::to_integer<std::size_t>(m_record[sizeof(uint16_t)]);
+			}
+
+			const std::byte* m_record = nullptr;
+		};
+
+		// Fails if the digest is longer than digest::max_size
+		bool push_back(uint16_t hash_alg, std::span<const std::byte> value)
+		{
+			if (value.size() > digest::max_size)
+			{
+				return false;
+			}
+
+			auto record_size = record_header_size + value.size();
+
+			if (m_spilled.empty() && m_used + record_size > inline_size)
+			{
+				m_spilled.reserve(2 * (m_used + record_size));
+				m_spilled.assign(m_inline.data(), m_inline.data() + m_used);
+			}
+
+			std::byte* record;
+
+			if (m_spilled.empty())
+			{
+				record = m_inline.data() + m_used;
+			}
+			else
+			{
+				m_spilled.resize(m_used + record_size);
+				record = m_spilled.data() + m_used;
+			}
+
+			std::memcpy(record, &hash_alg, sizeof(hash_alg));
+			record[sizeof(hash_alg)] = std::byte(value.size());
+			std::memcpy(record + record_header_size, value.data(), value.size());
+
+			m_used += static_cast<uint32_t>(record_size);
+			m_size++;
+
+			return true;
+		}
+
+		std::optional<digest_view> find(uint16_t hash_alg) const
+		{
+			for (auto digest : *this)
+			{
+				if (digest.hash_alg() == hash_alg)
+				{
+					return digest;
+				}
+			}
+
+			return {};
+		}
+
+		std::size_t size() const
+		{
+			return m_size;
+		}
+
+		bool empty() const
+		{
+			return m_size == 0;
+		}
+
+		digest_view operator[](std::size_t index) const
+		{
+			return *std::next(begin(), index);
+		}
+
+		iterator begin() const
+		{
+			return iterator(records().data());
+		}
+
+		iterator end() const
+		{
+			return iterator(records().data() + m_used);
+		}
+
+		// Banks with the same digests in the same order have the same records
+		bool operator==(const digest_bank& other) const
+		{
+			return m_size == other.m_size && std::ranges::equal(records(), other.records());
+		}
+
+	private:
+		std::span<const std::byte> records() const
+		{
+			return std::span(m_spilled.empty() ? m_inline.data() : m_spilled.data(), m_used);
+		}
+
+		std::array<std::byte, inline_size> m_inline;
+		std::vector<std::byte> m_spilled;
+		uint32_t m_used = 0;
+		uint32_t m_size = 0;
+	};
+} // namespace tcg_parser
@@ -0,0 +1,482 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "digest_bank.hpp"
+#include "mapped_file.hpp"
+#include "tcg_parser.hpp"
+
+namespace tcg_parser
+{
+	namespace details
+	{
+		struct digest_baseline_header
+		{
+			std::array<char, 8> magic;
+			uint32_t version;
+			uint32_t table_count;
+			// digest_baseline_table[table_count]
+			uint64_t tables;
+			uint64_t size;
+		};
+
+		// One table per hash algorithm, holding its digests in ascending byte order and a blocked Bloom filter over
+		// them
+		struct digest_baseline_table
+		{
+			uint16_t hash_alg;
+			uint16_t digest_size;
+			uint32_t reserved;
+			uint64_t count;
+			// std::byte[count * digest_size]
+			uint64_t digests;
+			// bloom_block[bloom_blocks], a power of two
+			uint64_t bloom_blocks;
+			uint64_t bloom;
+		};
+
+		// Each digest sets bloom_hashes bits within a single cache line, so a lookup touches at most one line of the
+		// filter. 16 bits per digest keep false positives well below one percent.
+		struct bloom_block
+		{
+			std::array<uint64_t, 8> words;
+		};
+
+		constexpr std::array<char, 8> digest_baseline_magic = { 'T', 'C', 'G', 'B', 'A', 'S', 'E', '\0' };
+		constexpr uint32_t digest_baseline_version = 1;
+		constexpr std::size_t bloom_hashes = 7;
+		constexpr std::size_t bloom_bits_per_digest = 16;
+
+		// Digests are already uniformly distributed, so their leading bytes serve as the hashes of the filter
+		std::array<uint64_t, 2> bloom_keys(std::span<const std::byte> digest)
+		{
+			std::array<uint64_t, 2> keys = {};
+
+			std::memcpy(keys.data(), digest.data(), std::min(size(digest), sizeof(keys)));
+
+			return keys;
+		}
+
+		void bloom_insert(std::span<bloom_block> filter, std::span<const std::byte> digest)
+		{
+			auto [block, bits] = bloom_keys(digest);
+
+			auto& words = filter[block & (size(filter) - 1)].words;
+
+			for (std::size_t i = 0; i < bloom_hashes; i++, bits >>= 9)
+			{
+				words[(bits >> 6) & 7] |= uint64_t(1) << (bits & 63);
+			}
+		}
+
+		bool bloom_contains(std::span<const bloom_block> filter, std::span<const std::byte> digest)
+		{
+			auto [block, bits] = bloom_keys(digest);
+
+			auto& words = filter[block & (size(filter) - 1)].words;
+
+			for (std::size_t i = 0; i < bloom_hashes; i++, bits >>= 9)
+			{
+				if (!(words[(bits >> 6) & 7] & (uint64_t(1) << (bits & 63))))
+				{
+					return false;
+				}
+			}
+
+			return true;
+		}
+	} // namespace details
+
+	// Collects known-good digests and writes them in the format read by digest_baseline
+	class digest_baseline_builder
+	{
+	public:
+		// Fails if the digest is longer than digest::max_size, or differs in size from earlier digests of its
+		// algorithm
+		bool add(uint16_t hash_alg, std::span<const std::byte> digest)
+		{
+			if (digest.empty() || size(digest) > digest::max_size)
+			{
+				return false;
+			}
+
+			auto entry = std::ranges::find(m_tables, hash_alg, &table::hash_alg);
+
+			if (entry == end(m_tables))
+			{
+				entry = m_tables.insert(end(m_tables), { hash_alg, static_cast<uint16_t>(size(digest)) });
+			}
+
+			if (size(digest) != entry->digest_size)
+			{
+				return false;
+			}
+
+			entry->digests.insert(end(entry->digests), digest.begin(), digest.end());
+
+			return true;
+		}
+
+		bool add(digest_view digest)
+		{
+			return add(digest.hash_alg(), digest.bytes());
+		}
+
+		// Sorts and deduplicates the digests of every algorithm
+		std::vector<std::byte> build() const
+		{
+			details::digest_baseline_header header {
+				.magic = details::digest_baseline_magic,
+				.version = details::digest_baseline_version,
+				.table_count = static_cast<uint32_t>(size(m_tables)),
+			};
+
+			std::vector<details::digest_baseline_table> tables(size(m_tables));
+			std::vector<std::byte> output(sizeof(header));
+
+			header.tables = size(output);
+			details::append_section(output, std::span<const details::digest_baseline_table>(tables));
+
+			for (std::size_t i = 0; i < size(m_tables); i++)
+			{
+				auto& table = m_tables[i];
+				auto digests = sorted_digests(table);
+				auto count = size(digests) / table.digest_size;
+
+				std::vector<details::bloom_block> bloom(
+					std::bit_ceil(std::max<std::size_t>(count * details::bloom_bits_per_digest / 512, 1))
+				);
+
+				for (std::size_t index = 0; index < count; index++)
+				{
+					auto digest = std::span(digests).subspan(index * table.digest_size, table.digest_size);
+
+					details::bloom_insert(bloom, digest);
+				}
+
+				tables[i] = {
+					.hash_alg = table.hash_alg,
+					.digest_size = table.digest_size,
+					.count = count,
+					.bloom_blocks = size(bloom),
+				};
+
+				tables[i].digests = size(output);
+				details::append_section(output, std::span<const std::byte>(digests));
+
+				tables[i].bloom = size(output);
+				details::append_section(output, std::span<const details::bloom_block>(bloom));
+			}
+
+			header.size = size(output);
+
+			std::memcpy(output.data(), &header, sizeof(header));
+			std::memcpy(output.data() + header.tables, tables.data(), size(tables) * sizeof(tables[0]));
+
+			return output;
+		}
+
+	private:
+		struct table
+		{
+			uint16_t hash_alg;
+			uint16_t digest_size;
+			std::vector<std::byte> digests;
+		};
+
+		static std::vector<std::byte> sorted_digests(const table& table)
+		{
+			auto digest_size = table.digest_size;
+			auto digest = [&](std::size_t index) {
+				return table.digests.data() + index * digest_size;
+			};
+
+			std::vector<std::size_t> order(size(table.digests) / digest_size);
+
+			std::iota(begin(order), end(order), 0);
+
+			std::ranges::sort(order, [&](auto left, auto right) {
+				return std::memcmp(digest(left), digest(right), digest_size) < 0;
+			});
+
+			auto duplicates = std::ranges::unique(order, [&](auto left, auto right) {
+				return std::memcmp(digest(left), digest(right), digest_size) == 0;
+			});
+
+			order.erase(duplicates.begin(), duplicates.end());
+
+			std::vector<std::byte> digests;
+
+			digests.reserve(size(order) * digest_size);
+
+			for (auto index : order)
+			{
+				digests.insert(end(digests), digest(index), digest(index) + digest_size);
+			}
+
+			return digests;
+		}
+
+		std::vector<table> m_tables;
+	};
+
+	// Known-good digests written by digest_baseline_builder. Opening a baseline only maps it; lookups go through the
+	// Bloom filter first and only binary search the sorted table for digests that pass it.
+	class digest_baseline
+	{
+	public:
+		static std::optional<digest_baseline> open(const char* path)
+		{
+			auto file = mapped_file::open(path);
+
+			if (!file)
+			{
+				return {};
+			}
+
+			auto baseline = load(file->data());
+
+			if (baseline)
+			{
+				baseline->m_file = std::move(file);
+			}
+
+			return baseline;
+		}
+
+		// Refers into the input, which must outlive the baseline and be aligned to 8 bytes
+		static std::optional<digest_baseline> load(std::span<const std::byte> input)
+		{
+			details::digest_baseline_header header;
+
+			if (reinterpret_cast<uintptr_t>(input.data()) % 8 || input.size() < sizeof(header))
+			{
+				return {};
+			}
+
+			std::memcpy(&header, input.data(), sizeof(header));
+
+			if (header.magic != details::digest_baseline_magic || header.version != details::digest_baseline_version ||
+				header.size != input.size())
+			{
+				return {};
+			}
+
+			auto tables =
+				details::file_section<details::digest_baseline_table>(input, header.tables, header.table_count);
+
+			if (!tables)
+			{
+				return {};
+			}
+
+			digest_baseline baseline;
+
+			for (auto& entry : *tables)
+			{
+				if (entry.digest_size == 0 || entry.digest_size > digest::max_size || entry.bloom_blocks == 0 ||
+					!std::has_single_bit(entry.bloom_blocks) || entry.count > input.size() / entry.digest_size)
+				{
+					return {};
+				}
+
+				auto digests = details::file_section<std::byte>(input, entry.digests, entry.count * entry.digest_size);
+				auto bloom = details::file_section<details::bloom_block>(input, entry.bloom, entry.bloom_blocks);
+
+				if (!digests || !bloom)
+				{
+					return {};
+				}
+
+				baseline.m_tables.push_back({
+					.hash_alg = entry.hash_alg,
+					.digest_size = entry.digest_size,
+					.digests = *digests,
+					.bloom = *bloom,
+				});
+			}
+
+			return baseline;
+		}
+
+		// Whether the baseline has any digests of the algorithm
+		bool covers(uint16_t hash_alg) const
+		{
+			return find(hash_alg) != nullptr;
+		}
+
+		bool contains(uint16_t hash_alg, std::span<const std::byte> value) const
+		{
+			auto table = find(hash_alg);
+
+			if (!table || size(value) != table->digest_size || !details::bloom_contains(table->bloom, value))
+			{
+				return false;
+			}
+
+			std::size_t low = 0;
+			std::size_t high = size(table->digests) / table->digest_size;
+
+			while (low < high)
+			{
+				auto middle = low + (high - low) / 2;
+				auto entry = table->digests.data() + middle * table->digest_size;
+				auto order = std::memcmp(entry, value.data(), size(value));
+
+				if (order == 0)
+				{
+					return true;
+				}
+
+				if (order < 0)
+				{
+					low = middle + 1;
+				}
+				else
+				{
+					high = middle;
+				}
+			}
+
+			return false;
+		}
+
+		bool contains(digest_view digest) const
+		{
+			return contains(digest.hash_alg(), digest.bytes());
+		}
+
+		// An event is known if at least one of its digests is of an algorithm the baseline covers, and all digests of
+		// covered algorithms are in the baseline
+		bool known(const digest_bank& digests) const
+		{
+			auto checked = false;
+
+			for (auto digest : digests)
+			{
+				if (covers(digest.hash_alg()))
+				{
+					if (!contains(digest))
+					{
+						return false;
+					}
+
+					checked = true;
+				}
+			}
+
+			return checked;
+		}
+
+		bool known(const tcg_pgr_event_2_view& view, const std::vector<events::efi_spec_id::digest_size>& digest_sizes)
+			const
+		{
+			auto checked = false;
+			auto unknown = false;
+
+			details::for_each_digest(view, digest_sizes, [&](uint16_t hash_alg, std::span<const std::byte> digest) {
+				if (covers(hash_alg))
+				{
+					unknown |= !contains(hash_alg, digest);
+					checked = true;
+				}
+			});
+
+			return checked && !unknown;
+		}
+
+	private:
+		struct table
+		{
+			uint16_t hash_alg;
+			uint16_t digest_size;
+			std::span<const std::byte> digests;
+			std::span<const details::bloom_block> bloom;
+		};
+
+		digest_baseline() = default;
+
+		const table* find(uint16_t hash_alg) const
+		{
+			auto entry = std::ranges::find(m_tables, hash_alg, &table::hash_alg);
+
+			if (entry == end(m_tables))
+			{
+				return nullptr;
+			}
+
+			return &*entry;
+		}
+
+		std::optional<mapped_file> m_file;
+		std::vector<table> m_tables;
+	};
+
+	namespace details
+	{
+		bool is_boot_services_image(uint32_t event_type)
+		{
+			return event_type == EV_EFI_BOOT_SERVICES_APPLICATION || event_type == EV_EFI_BOOT_SERVICES_DRIVER;
+		}
+	} // namespace details
+
+	// Returns the numbers of the EV_EFI_BOOT_SERVICES_APPLICATION and EV_EFI_BOOT_SERVICES_DRIVER events whose
+	// digests are not known to the baseline. Events are numbered as in event_index.
+	std::vector<std::size_t> unknown_images(
+		const digest_baseline& baseline,
+		std::span<const std::byte> input,
+		const std::vector<events::efi_spec_id::digest_size>& digest_sizes
+	)
+	{
+		std::vector<std::size_t> unknown;
+
+		event_framer framer(digest_sizes);
+
+		for (std::size_t event = 0; auto view = framer(input); event++)
+		{
+			if (details::is_boot_services_image(view->event_type) && !baseline.known(*view, digest_sizes))
+			{
+				unknown.push_back(event);
+			}
+		}
+
+		return unknown;
+	}
+
+	// Checks every boot services application and driver in a single pass, stopping at the first unknown one.
+	// A log that cannot be framed up to its end is never considered known.
+	bool all_images_known(
+		const digest_baseline& baseline,
+		std::span<const std::byte> input,
+		const std::vector<events::efi_spec_id::digest_size>& digest_sizes
+	)
+	{
+		event_framer framer(digest_sizes);
+
+		while (auto view = framer(input))
+		{
+			if (details::is_boot_services_image(view->event_type) && !baseline.known(*view, digest_sizes))
+			{
+				return false;
+			}
+		}
+
+		return input.empty();
+	}
+
+	bool all_images_known(const digest_baseline& baseline, std::span<const tcg_pgr_event_2> events)
+	{
+		return std::ranges::all_of(events, [&](auto& event) {
+			return !details::is_boot_services_image(event.event_type) || baseline.known(event.digests);
+		});
+	}
+} // namespace tcg_parser
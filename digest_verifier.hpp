@@ -0,0 +1,201 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <thread>
+#include <variant>
+#include <vector>
+
+#include "digest_bank.hpp"
+#include "parallel.hpp"
+#include "reader.hpp"
+#include "sha.hpp"
+#include "tcg_parser.hpp"
+
+namespace tcg_parser
+{
+	namespace details
+	{
+		// Whether the digests of an event type are the hash of its event data, rather than of something that is not in
+		// the log, such as an image or a firmware volume
+		constexpr bool digests_cover_data(uint32_t event_type)
+		{
+			switch (event_type)
+			{
+			case EV_SEPARATOR:
+			case EV_ACTION:
+			case EV_S_CRTM_VERSION:
+			case EV_IPL:
+			case EV_EFI_ACTION:
+			case EV_EFI_GPT_EVENT:
+			case EV_EFI_VARIABLE_DRIVER_CONFIG:
+			case EV_EFI_VARIABLE_BOOT:
+			case EV_EFI_VARIABLE_AUTHORITY:
+				return true;
+			default:
+				return false;
+			}
+		}
+
+		// Returns the bytes of the event data that the digests are the hash of: all of it, except for
+		// EV_EFI_VARIABLE_BOOT, which only hashes the variable data. Fails if that is cut short.
+		std::optional<std::span<const std::byte>> hashed_data(uint32_t event_type, std::span<const std::byte> data)
+		{
+			if (event_type == EV_EFI_VARIABLE_BOOT)
+			{
+				span_reader reader(data);
+
+				uint64_t unicode_name_length = 0;
+				uint64_t variable_data_length = 0;
+
+				reader.skip(offsetof(events::efi_variable_boot, unicode_name));
+				reader.read(&unicode_name_length, sizeof(unicode_name_length));
+				reader.read(&variable_data_length, sizeof(variable_data_length));
+
+				auto remaining = reader.remaining();
+
+				if (!reader.good() || unicode_name_length > size(remaining) / sizeof(char16_t))
+				{
+					return {};
+				}
+
+				remaining = remaining.subspan(unicode_name_length * sizeof(char16_t));
+
+				if (variable_data_length > size(remaining))
+				{
+					return {};
+				}
+
+				return remaining.first(variable_data_length);
+			}
+
+			return data;
+		}
+	} // namespace details
+
+	// An event whose recorded digest is not the hash of its event data
+	struct digest_mismatch
+	{
+		// Where the event starts in the log, and how many events come before it after the spec ID event
+		std::size_t offset;
+		std::size_t index;
+		uint32_t pcr_index;
+		uint32_t event_type;
+		digest recorded;
+		// Empty if the event data is too short to tell which bytes were hashed
+		digest computed;
+	};
+
+	// Recomputes the digests of events from their event data and compares them with the ones the log records, for
+	// every bank that hash can compute. The log is framed a window of events at a time, whose payloads are then
+	// hashed across a pool of threads, so apart from the mismatches, memory does not grow with the size of the log.
+	class digest_verifier
+	{
+	public:
+		explicit digest_verifier(unsigned thread_count = std::thread::hardware_concurrency())
+			: m_pool(thread_count)
+		{
+		}
+
+		// Returns the mismatches in log order. Fails if the log does not start with a spec ID event.
+		std::optional<std::vector<digest_mismatch>> verify(std::span<const std::byte> input)
+		{
+			auto log = input;
+			auto header = read_event_1(input);
+
+			if (!header)
+			{
+				return {};
+			}
+
+			auto spec_event = std::get_if<events::efi_spec_id>(&header->event);
+
+			if (!spec_event)
+			{
+				return {};
+			}
+
+			auto& digest_sizes = spec_event->digest_sizes;
+
+			event_framer framer(digest_sizes);
+
+			std::vector<digest_mismatch> mismatches;
+			std::vector<tcg_pgr_event_2_view> views;
+			std::vector<std::size_t> offsets;
+			// The mismatches of each event of the window, filled in by whichever thread hashes it
+			std::vector<std::vector<digest_mismatch>> found(window_size);
+
+			for (std::size_t first = 0;; first += size(views))
+			{
+				views.clear();
+				offsets.clear();
+
+				while (size(views) < window_size)
+				{
+					auto offset = static_cast<std::size_t>(input.data() - log.data());
+					auto view = framer(input);
+
+					if (!view)
+					{
+						break;
+					}
+
+					views.push_back(*view);
+					offsets.push_back(offset);
+				}
+
+				if (views.empty())
+				{
+					return mismatches;
+				}
+
+				m_pool.for_each_index(size(views), chunk_size, [&](std::size_t i) {
+					auto& view = views[i];
+
+					if (!details::digests_cover_data(view.event_type))
+					{
+						return;
+					}
+
+					auto data = details::hashed_data(view.event_type, view.event);
+
+					details::for_each_digest(view, digest_sizes, [&](uint16_t hash_alg, auto recorded) {
+						if (!can_hash(hash_alg))
+						{
+							return;
+						}
+
+						auto computed = data ? hash(hash_alg, *data) : digest();
+
+						if (!std::ranges::equal(computed.bytes(), recorded))
+						{
+							found[i].push_back(digest_mismatch {
+								.offset = offsets[i],
+								.index = first + i,
+								.pcr_index = view.pcr_index,
+								.event_type = view.event_type,
+								.recorded = digest(hash_alg, recorded),
+								.computed = computed,
+							});
+						}
+					});
+				});
+
+				for (std::size_t i = 0; i < size(views); i++)
+				{
+					mismatches.insert(mismatches.end(), found[i].begin(), found[i].end());
+					found[i].clear();
+				}
+			}
+		}
+
+	private:
+		static constexpr std::size_t window_size = 4096;
+		static constexpr std::size_t chunk_size = 16;
+
+		details::work_stealing_pool m_pool;
+	};
+} // namespace tcg_parser
@@ -0,0 +1,557 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <iterator>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+#include "event_views.hpp"
+#include "mapped_file.hpp"
+#include "tcg_parser.hpp"
+
+namespace tcg_parser
+{
+	namespace details
+	{
+		// Layout of a cache file. Every section starts at a multiple of 8 bytes from the start of the file, and all
+		// offsets are relative to the start of the file.
+		struct event_cache_header
+		{
+			std::array<char, 8> magic;
+			uint32_t version;
+			uint32_t event_count;
+			uint32_t bank_count;
+			uint32_t reserved;
+
+			// uint32_t[event_count]
+			uint64_t pcr_indices;
+			// uint32_t[event_count]
+			uint64_t event_types;
+			// uint8_t[event_count], bit N is set if the event has a digest in bank N
+			uint64_t digest_masks;
+			// event_cache_bank[bank_count]
+			uint64_t banks;
+			// uint64_t[event_count + 1], event N spans from entry N to entry N + 1 of the payload section
+			uint64_t payload_offsets;
+			uint64_t payloads;
+			// uint64_t[event_count + 1], same as the payload offsets
+			uint64_t text_offsets;
+			uint64_t texts;
+
+			uint64_t size;
+		};
+
+		// The digests of one bank are stored back to back, with zeros for events that have no digest in the bank
+		struct event_cache_bank
+		{
+			uint16_t hash_alg;
+			uint16_t digest_size;
+			uint32_t reserved;
+			uint64_t digests;
+		};
+
+		constexpr std::array<char, 8> event_cache_magic = { 'T', 'C', 'G', 'C', 'A', 'C', 'H', 'E' };
+		constexpr uint32_t event_cache_version = 1;
+		constexpr std::size_t event_cache_max_banks = 8;
+
+		void append_text(std::string& text, const event_views::utf16_view& data)
+		{
+			for (auto character : data)
+			{
+				text.push_back(static_cast<char>(character));
+			}
+		}
+
+		void append_text(std::string& text, const event_views::s_crtm_version& event)
+		{
+			append_text(text, event.data);
+		}
+
+		void append_text(std::string& text, const event_views::ipl& event)
+		{
+			append_text(text, event.data);
+		}
+
+		void append_text(std::string& text, const event_views::efi_action& event)
+		{
+			text += event.data;
+		}
+
+		void append_text(std::string& text, const event_views::uefi_image_load& event)
+		{
+			std::format_to(back_inserter(text), "{}", event.device_path);
+		}
+
+		void append_text(std::string& text, const event_views::efi_variable_base& event)
+		{
+			append_text(text, event.unicode_name);
+		}
+
+		void append_text(
+			std::string& text,
+			const std::variant<std::string_view, events::uefi_blob_1, event_views::uefi_blob_2>& data
+		)
+		{
+			if (auto string = std::get_if<std::string_view>(&data))
+			{
+				text += *string;
+			}
+			else if (auto blob = std::get_if<event_views::uefi_blob_2>(&data))
+			{
+				text += blob->blob_description;
+			}
+		}
+
+		void append_text(std::string& text, const event_views::post_code& event)
+		{
+			append_text(text, event.data);
+		}
+
+		void append_text(std::string& text, const event_views::efi_hcrtm& event)
+		{
+			append_text(text, event.data);
+		}
+	} // namespace details
+
+	// Converts a log into the cache format read by event_cache. Every event that read_event_2 can read is stored,
+	// together with the text of its payload: device paths, variable names, descriptions and strings.
+	std::optional<std::vector<std::byte>> write_event_cache(std::span<const std::byte> input)
+	{
+		auto header = read_event_1(input);
+
+		if (!header)
+		{
+			return {};
+		}
+
+		auto spec_event = std::get_if<events::efi_spec_id>(&header->event);
+
+		if (!spec_event || size(spec_event->digest_sizes) > details::event_cache_max_banks)
+		{
+			return {};
+		}
+
+		auto& digest_sizes = spec_event->digest_sizes;
+
+		std::vector<uint32_t> pcr_indices;
+		std::vector<uint32_t> event_types;
+		std::vector<uint8_t> digest_masks;
+		std::vector<std::vector<std::byte>> digests(size(digest_sizes));
+		std::vector<uint64_t> payload_offsets = { 0 };
+		std::vector<std::byte> payloads;
+		std::vector<uint64_t> text_offsets = { 0 };
+		std::string texts;
+
+		event_framer framer(digest_sizes);
+
+		while (auto view = framer(input))
+		{
+			uint8_t mask = 0;
+
+			for (std::size_t bank = 0; bank < size(digest_sizes); bank++)
+			{
+				digests[bank].resize(size(digests[bank]) + digest_sizes[bank].digest_size);
+			}
+
+			details::for_each_digest(*view, digest_sizes, [&](uint16_t hash_alg, std::span<const std::byte> digest) {
+				auto bank = std::ranges::find(digest_sizes, hash_alg, &events::efi_spec_id::digest_size::hash_alg) -
+							begin(digest_sizes);
+
+				mask |= 1 << bank;
+
+				std::ranges::copy(digest, end(digests[bank]) - size(digest));
+			});
+
+			visit_event_payload(*view, [&](const auto&, const auto& payload) {
+				if constexpr (requires { details::append_text(texts, payload); })
+				{
+					details::append_text(texts, payload);
+				}
+			});
+
+			pcr_indices.push_back(view->pcr_index);
+			event_types.push_back(view->event_type);
+			digest_masks.push_back(mask);
+
+			payloads.insert(end(payloads), view->event.begin(), view->event.end());
+			payload_offsets.push_back(size(payloads));
+			text_offsets.push_back(size(texts));
+		}
+
+		details::event_cache_header cache_header {
+			.magic = details::event_cache_magic,
+			.version = details::event_cache_version,
+			.event_count = static_cast<uint32_t>(size(pcr_indices)),
+			.bank_count = static_cast<uint32_t>(size(digest_sizes)),
+		};
+
+		std::vector<details::event_cache_bank> banks(size(digest_sizes));
+		std::vector<std::byte> output(sizeof(cache_header));
+
+		cache_header.pcr_indices = size(output);
+		details::append_section(output, std::span<const uint32_t>(pcr_indices));
+
+		cache_header.event_types = size(output);
+		details::append_section(output, std::span<const uint32_t>(event_types));
+
+		cache_header.digest_masks = size(output);
+		details::append_section(output, std::span<const uint8_t>(digest_masks));
+
+		cache_header.banks = size(output);
+		details::append_section(output, std::span<const details::event_cache_bank>(banks));
+
+		for (std::size_t bank = 0; bank < size(digest_sizes); bank++)
+		{
+			banks[bank] = {
+				.hash_alg = digest_sizes[bank].hash_alg,
+				.digest_size = digest_sizes[bank].digest_size,
+				.digests = size(output),
+			};
+
+			details::append_section(output, std::span<const std::byte>(digests[bank]));
+		}
+
+		std::memcpy(output.data() + cache_header.banks, banks.data(), size(banks) * sizeof(details::event_cache_bank));
+
+		cache_header.payload_offsets = size(output);
+		details::append_section(output, std::span<const uint64_t>(payload_offsets));
+
+		cache_header.payloads = size(output);
+		details::append_section(output, std::span<const std::byte>(payloads));
+
+		cache_header.text_offsets = size(output);
+		details::append_section(output, std::span<const uint64_t>(text_offsets));
+
+		cache_header.texts = size(output);
+		details::append_section(output, std::as_bytes(std::span(texts)));
+
+		cache_header.size = size(output);
+
+		std::memcpy(output.data(), &cache_header, sizeof(cache_header));
+
+		return output;
+	}
+
+	class event_cache;
+
+	// An event of an event_cache, with the same accessors as tcg_pgr_lazy_event_2
+	class cached_event_2
+	{
+	public:
+		cached_event_2(const event_cache& cache, std::size_t event)
+			: m_cache(&cache)
+			, m_event(event)
+		{
+		}
+
+		uint32_t pcr_index() const;
+
+		uint32_t event_type() const;
+
+		std::span<const std::byte> digest(uint16_t hash_alg) const;
+
+		digest_bank digests() const;
+
+		void for_each_digest(auto&& function) const;
+
+		std::span<const std::byte> data() const;
+
+		std::string_view text() const;
+
+		const event_payload_t& event() const;
+
+	private:
+		const event_cache* m_cache;
+		std::size_t m_event;
+		mutable std::optional<event_payload_t> m_payload;
+	};
+
+	// Reads a cache written by write_event_cache. Opening a cache only maps it and checks that its sections lie
+	// within the file; events are never decoded unless their payload is requested.
+	class event_cache
+	{
+	public:
+		static std::optional<event_cache> open(const char* path)
+		{
+			auto file = mapped_file::open(path);
+
+			if (!file)
+			{
+				return {};
+			}
+
+			auto cache = load(file->data());
+
+			if (cache)
+			{
+				cache->m_file = std::move(file);
+			}
+
+			return cache;
+		}
+
+		// Refers into the input, which must outlive the cache and be aligned to 8 bytes
+		static std::optional<event_cache> load(std::span<const std::byte> input)
+		{
+			details::event_cache_header header;
+
+			if (reinterpret_cast<uintptr_t>(input.data()) % 8 || input.size() < sizeof(header))
+			{
+				return {};
+			}
+
+			std::memcpy(&header, input.data(), sizeof(header));
+
+			if (header.magic != details::event_cache_magic || header.version != details::event_cache_version ||
+				header.size != input.size() || header.bank_count > details::event_cache_max_banks)
+			{
+				return {};
+			}
+
+			event_cache cache;
+
+			auto pcr_indices = details::file_section<uint32_t>(input, header.pcr_indices, header.event_count);
+			auto event_types = details::file_section<uint32_t>(input, header.event_types, header.event_count);
+			auto digest_masks = details::file_section<uint8_t>(input, header.digest_masks, header.event_count);
+			auto banks = details::file_section<details::event_cache_bank>(input, header.banks, header.bank_count);
+			auto payload_offsets =
+				details::file_section<uint64_t>(input, header.payload_offsets, uint64_t(header.event_count) + 1);
+			auto text_offsets =
+				details::file_section<uint64_t>(input, header.text_offsets, uint64_t(header.event_count) + 1);
+
+			if (!pcr_indices || !event_types || !digest_masks || !banks || !payload_offsets || !text_offsets)
+			{
+				return {};
+			}
+
+			auto payloads = details::file_section<std::byte>(input, header.payloads, payload_offsets->back());
+			auto texts = details::file_section<char>(input, header.texts, text_offsets->back());
+
+			if (!payloads || !texts)
+			{
+				return {};
+			}
+
+			for (auto& bank : *banks)
+			{
+				if (bank.digest_size > digest::max_size)
+				{
+					return {};
+				}
+
+				auto digests = details::file_section<std::byte>(
+					input,
+					bank.digests,
+					uint64_t(header.event_count) * bank.digest_size
+				);
+
+				if (!digests)
+				{
+					return {};
+				}
+
+				cache.m_digest_sizes.push_back({ .hash_alg = bank.hash_alg, .digest_size = bank.digest_size });
+				cache.m_digests.push_back(*digests);
+			}
+
+			cache.m_pcr_indices = *pcr_indices;
+			cache.m_event_types = *event_types;
+			cache.m_digest_masks = *digest_masks;
+			cache.m_payload_offsets = *payload_offsets;
+			cache.m_payloads = *payloads;
+			cache.m_text_offsets = *text_offsets;
+			cache.m_texts = std::string_view(texts->data(), texts->size());
+
+			return cache;
+		}
+
+		std::size_t size() const
+		{
+			return std::size(m_pcr_indices);
+		}
+
+		// The digest sizes of the spec ID event of the log the cache was written from
+		const std::vector<events::efi_spec_id::digest_size>& digest_sizes() const
+		{
+			return m_digest_sizes;
+		}
+
+		uint32_t pcr_index(std::size_t event) const
+		{
+			return m_pcr_indices[event];
+		}
+
+		uint32_t event_type(std::size_t event) const
+		{
+			return m_event_types[event];
+		}
+
+		std::span<const uint32_t> pcr_indices() const
+		{
+			return m_pcr_indices;
+		}
+
+		std::span<const uint32_t> event_types() const
+		{
+			return m_event_types;
+		}
+
+		std::span<const std::byte> digest(std::size_t event, uint16_t hash_alg) const
+		{
+			for (std::size_t bank = 0; bank < m_digest_sizes.size(); bank++)
+			{
+				if (m_digest_sizes[bank].hash_alg == hash_alg)
+				{
+					if (!(m_digest_masks[event] & (1 << bank)))
+					{
+						return {};
+					}
+
+					return bank_digest(event, bank);
+				}
+			}
+
+			return {};
+		}
+
+		digest_bank digests(std::size_t event) const
+		{
+			digest_bank digests;
+
+			for_each_digest(event, [&](uint16_t hash_alg, std::span<const std::byte> digest) {
+				digests.push_back(hash_alg, digest);
+			});
+
+			return digests;
+		}
+
+		void for_each_digest(std::size_t event, auto&& function) const
+		{
+			for (std::size_t bank = 0; bank < m_digest_sizes.size(); bank++)
+			{
+				if (m_digest_masks[event] & (1 << bank))
+				{
+					function(m_digest_sizes[bank].hash_alg, bank_digest(event, bank));
+				}
+			}
+		}
+
+		// The payload of the event as it was stored in the log
+		std::span<const std::byte> data(std::size_t event) const
+		{
+			auto begin = m_payload_offsets[event];
+			auto end = m_payload_offsets[event + 1];
+
+			if (begin > end || end > m_payloads.size())
+			{
+				return {};
+			}
+
+			return m_payloads.subspan(begin, end - begin);
+		}
+
+		// The device path, variable name or text of the event, or an empty string for other payloads
+		std::string_view text(std::size_t event) const
+		{
+			auto begin = m_text_offsets[event];
+			auto end = m_text_offsets[event + 1];
+
+			if (begin > end || end > m_texts.size())
+			{
+				return {};
+			}
+
+			return m_texts.substr(begin, end - begin);
+		}
+
+		event_payload_t event(std::size_t event) const
+		{
+			tcg_pgr_event_2_view header {
+				.pcr_index = pcr_index(event),
+				.event_type = event_type(event),
+			};
+
+			return read_event_payload(header, data(event));
+		}
+
+		cached_event_2 operator[](std::size_t event) const
+		{
+			return cached_event_2(*this, event);
+		}
+
+	private:
+		event_cache() = default;
+
+		std::span<const std::byte> bank_digest(std::size_t event, std::size_t bank) const
+		{
+			auto digest_size = m_digest_sizes[bank].digest_size;
+
+			return m_digests[bank].subspan(event * digest_size, digest_size);
+		}
+
+		std::optional<mapped_file> m_file;
+		std::vector<events::efi_spec_id::digest_size> m_digest_sizes;
+		std::vector<std::span<const std::byte>> m_digests;
+		std::span<const uint32_t> m_pcr_indices;
+		std::span<const uint32_t> m_event_types;
+		std::span<const uint8_t> m_digest_masks;
+		std::span<const uint64_t> m_payload_offsets;
+		std::span<const std::byte> m_payloads;
+		std::span<const uint64_t> m_text_offsets;
+		std::string_view m_texts;
+	};
+
+	uint32_t cached_event_2::pcr_index() const
+	{
+		return m_cache->pcr_index(m_event);
+	}
+
+	uint32_t cached_event_2::event_type() const
+	{
+		return m_cache->event_type(m_event);
+	}
+
+	std::span<const std::byte> cached_event_2::digest(uint16_t hash_alg) const
+	{
+		return m_cache->digest(m_event, hash_alg);
+	}
+
+	digest_bank cached_event_2::digests() const
+	{
+		return m_cache->digests(m_event);
+	}
+
+	void cached_event_2::for_each_digest(auto&& function) const
+	{
+		m_cache->for_each_digest(m_event, function);
+	}
+
+	std::span<const std::byte> cached_event_2::data() const
+	{
+		return m_cache->data(m_event);
+	}
+
+	std::string_view cached_event_2::text() const
+	{
+		return m_cache->text(m_event);
+	}
+
+	const event_payload_t& cached_event_2::event() const
+	{
+		if (!m_payload)
+		{
+			m_payload = m_cache->event(m_event);
+		}
+
+		return *m_payload;
+	}
+} // namespace tcg_parser
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "parse_limits.hpp"
+#include "tcg_parser.hpp"
+
+namespace tcg_parser
+{
+	// Selects the events and digest banks to keep while parsing. An empty list keeps everything.
+	struct event_filter
+	{
+		std::vector<uint32_t> pcr_indices;
+		std::vector<uint32_t> event_types;
+		std::vector<uint16_t> hash_algs;
+
+		bool matches(const tcg_pgr_event_2_view& view) const
+		{
+			return contains(pcr_indices, view.pcr_index) && contains(event_types, view.event_type);
+		}
+
+		bool keeps(uint16_t hash_alg) const
+		{
+			return contains(hash_algs, hash_alg);
+		}
+
+	private:
+		static bool contains(const auto& values, auto value)
+		{
+			return values.empty() || std::ranges::find(values, value) != end(values);
+		}
+	};
+
+	tcg_pgr_event_2 decode_event_2(
+		const tcg_pgr_event_2_view& view,
+		const std::vector<events::efi_spec_id::digest_size>& digest_sizes,
+		const event_filter& filter,
+		const parse_limits& limits
+	)
+	{
+		tcg_pgr_event_2 header {
+			.pcr_index = view.pcr_index,
+			.event_type = view.event_type,
+		};
+
+		details::for_each_digest(view, digest_sizes, [&](uint16_t hash_alg, std::span<const std::byte> digest) {
+			if (filter.keeps(hash_alg))
+			{
+				header.digests.push_back(hash_alg, digest);
+			}
+		});
+
+		header.event = read_event_payload(header, view.event, limits);
+
+		return header;
+	}
+
+	tcg_pgr_event_2 decode_event_2(
+		const tcg_pgr_event_2_view& view,
+		const std::vector<events::efi_spec_id::digest_size>& digest_sizes,
+		const event_filter& filter
+	)
+	{
+		return decode_event_2(view, digest_sizes, filter, parse_limits());
+	}
+
+	// Reads the next event that matches the filter, within the budget of its log. Events that do not match are framed
+	// and skipped over without copying or decoding anything, and take nothing from the budget. Fails without
+	// consuming the matching event if its event data does not fit.
+	std::optional<tcg_pgr_event_2> read_event_2(
+		std::span<const std::byte>& input,
+		const event_framer& framer,
+		const event_filter& filter,
+		parse_budget& budget
+	)
+	{
+		auto remaining = input;
+
+		while (auto view = framer(remaining))
+		{
+			if (filter.matches(*view))
+			{
+				if (!budget.take(size(view->event)))
+				{
+					return {};
+				}
+
+				input = remaining;
+
+				return decode_event_2(*view, framer.digest_sizes(), filter, budget.limits());
+			}
+
+			input = remaining;
+		}
+
+		return {};
+	}
+
+	std::optional<tcg_pgr_event_2> read_event_2(
+		std::span<const std::byte>& input,
+		const event_framer& framer,
+		const event_filter& filter
+	)
+	{
+		parse_budget budget;
+
+		return read_event_2(input, framer, filter, budget);
+	}
+} // namespace tcg_parser
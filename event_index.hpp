@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include "tcg_parser.hpp"
+
+namespace tcg_parser
+{
+	// Records where every event of a log starts, so that events can be reached directly instead of
+	// re-parsing the log from the start. Refers into the input and the digest sizes it was built with.
+	class event_index
+	{
+	public:
+		static std::optional<event_index> build(
+			std::span<const std::byte> input,
+			const std::vector<events::efi_spec_id::digest_size>& digest_sizes
+		)
+		{
+			if (input.size() > std::numeric_limits<uint32_t>::max())
+			{
+				return {};
+			}
+
+			event_index index(input, digest_sizes);
+
+			auto cursor = input;
+
+			index.m_offsets.push_back(0);
+
+			while (auto view = index.m_framer(cursor))
+			{
+				auto event = static_cast<uint32_t>(index.m_pcr_indices.size());
+
+				index.m_offsets.push_back(static_cast<uint32_t>(input.size() - cursor.size()));
+				index.m_pcr_indices.push_back(view->pcr_index);
+				index.m_event_types.push_back(view->event_type);
+				index.m_by_pcr[view->pcr_index].push_back(event);
+				index.m_by_event_type[view->event_type].push_back(event);
+			}
+
+			return index;
+		}
+
+		std::size_t size() const
+		{
+			return std::size(m_pcr_indices);
+		}
+
+		uint32_t offset(std::size_t event) const
+		{
+			return m_offsets[event];
+		}
+
+		uint32_t event_size(std::size_t event) const
+		{
+			return m_offsets[event + 1] - m_offsets[event];
+		}
+
+		uint32_t pcr_index(std::size_t event) const
+		{
+			return m_pcr_indices[event];
+		}
+
+		uint32_t event_type(std::size_t event) const
+		{
+			return m_event_types[event];
+		}
+
+		std::span<const std::byte> data(std::size_t event) const
+		{
+			return m_input.subspan(offset(event), event_size(event));
+		}
+
+		tcg_pgr_lazy_event_2 operator[](std::size_t event) const
+		{
+			auto input = data(event);
+
+			return *read_lazy_event_2(input, m_framer);
+		}
+
+		std::span<const uint32_t> by_pcr(uint32_t pcr_index) const
+		{
+			if (auto entry = m_by_pcr.find(pcr_index); entry != end(m_by_pcr))
+			{
+				return entry->second;
+			}
+
+			return {};
+		}
+
+		std::span<const uint32_t> by_event_type(uint32_t event_type) const
+		{
+			if (auto entry = m_by_event_type.find(event_type); entry != end(m_by_event_type))
+			{
+				return entry->second;
+			}
+
+			return {};
+		}
+
+	private:
+		event_index(
+			std::span<const std::byte> input,
+			const std::vector<events::efi_spec_id::digest_size>& digest_sizes
+		)
+			: m_input(input)
+			, m_framer(digest_sizes)
+		{
+		}
+
+		std::span<const std::byte> m_input;
+		event_framer m_framer;
+
+		// Event N spans from m_offsets[N] to m_offsets[N + 1]
+		std::vector<uint32_t> m_offsets;
+		std::vector<uint32_t> m_pcr_indices;
+		std::vector<uint32_t> m_event_types;
+
+		std::unordered_map<uint32_t, std::vector<uint32_t>> m_by_pcr;
+		std::unordered_map<uint32_t, std::vector<uint32_t>> m_by_event_type;
+	};
+} // namespace tcg_parser
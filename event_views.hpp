@@ -0,0 +1,403 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <span>
+#include <string>
+#include <string_view>
+#include <variant>
+
+#include "tcg_parser.hpp"
+
+namespace tcg_parser
+{
+	// Non-owning counterparts of the payloads in events.hpp. They refer directly into the log and are only valid
+	// for as long as the log itself.
+	namespace event_views
+	{
+		// UTF-16 text stored in the log, which is not necessarily aligned for char16_t
+		class utf16_view
+		{
+		public:
+			class iterator
+			{
+			public:
+				using iterator_category = std::forward_iterator_tag;
+				using value_type = char16_t;
+				using difference_type = std::ptrdiff_t;
+				using pointer = void;
+				using reference = char16_t;
+
+				iterator() = default;
+
+				explicit iterator(const std::byte* position)
+					: m_position(position)
+				{
+				}
+
+				char16_t operator*() const
+				{
+					char16_t character;
+
+					std::memcpy(&character, m_position, sizeof(character));
+
+					return character;
+				}
+
+				iterator& operator++()
+				{
+					m_position += sizeof(char16_t);
+
+					return *this;
+				}
+
+				iterator operator++(int)
+				{
+					auto result = *this;
+
+					++*this;
+
+					return result;
+				}
+
+				bool operator==(const iterator& other) const = default;
+
+			private:
+				const std::byte* m_position = nullptr;
+			};
+
+			utf16_view() = default;
+
+			explicit utf16_view(std::span<const std::byte> bytes)
+				: m_bytes(bytes.first(bytes.size() & ~std::size_t(1)))
+			{
+			}
+
+			std::size_t size() const
+			{
+				return std::size(m_bytes) / sizeof(char16_t);
+			}
+
+			bool empty() const
+			{
+				return m_bytes.empty();
+			}
+
+			iterator begin() const
+			{
+				return iterator(m_bytes.data());
+			}
+
+			iterator end() const
+			{
+				return iterator(m_bytes.data() + std::size(m_bytes));
+			}
+
+			std::span<const std::byte> bytes() const
+			{
+				return m_bytes;
+			}
+
+			std::u16string to_u16string() const
+			{
+				return std::u16string(begin(), end());
+			}
+
+		private:
+			std::span<const std::byte> m_bytes;
+		};
+
+		struct uefi_image_load
+		{
+			uint64_t image_location_in_memory;
+			uint64_t image_length_in_memory;
+			uint64_t image_link_time_address;
+			device_path_view device_path;
+		};
+
+		struct efi_boot_services_application : uefi_image_load
+		{
+		};
+
+		struct efi_boot_services_driver : uefi_image_load
+		{
+		};
+
+		struct efi_runtime_services_driver : uefi_image_load
+		{
+		};
+
+		struct uefi_blob_2
+		{
+			std::string_view blob_description;
+			uint64_t blob_base;
+			uint64_t blob_length;
+		};
+
+		struct post_code
+		{
+			std::variant<std::string_view, events::uefi_blob_1, uefi_blob_2> data;
+		};
+
+		struct efi_variable_base
+		{
+			std::array<uint8_t, 16> variable_name;
+			utf16_view unicode_name;
+			std::span<const std::byte> variable_data;
+		};
+
+		struct efi_variable_boot : efi_variable_base
+		{
+		};
+
+		struct efi_variable_driver_config : efi_variable_base
+		{
+		};
+
+		struct efi_variable_authority : efi_variable_base
+		{
+		};
+
+		struct efi_action
+		{
+			std::string_view data;
+		};
+
+		struct ipl
+		{
+			utf16_view data;
+		};
+
+		struct s_crtm_version
+		{
+			utf16_view data;
+		};
+
+		struct efi_hcrtm
+		{
+			std::variant<std::string_view, events::uefi_blob_1, uefi_blob_2> data;
+		};
+
+		using events::efi_platform_firmware_blob;
+		using events::separator;
+
+		using raw_event_t = std::span<const std::byte>;
+	} // namespace event_views
+
+	namespace details
+	{
+		std::string_view read_text(std::span<const std::byte> bytes)
+		{
+			return std::string_view(reinterpret_cast<const char*>(bytes.data()), size(bytes));
+		}
+
+		// Reads UTF-16 text up to and including its terminator, or up to the end of the input if there is none
+		event_views::utf16_view read_utf16(span_reader& reader)
+		{
+			auto input = reader.remaining();
+
+			for (std::size_t offset = 0; offset + sizeof(char16_t) <= size(input); offset += sizeof(char16_t))
+			{
+				if (input[offset] == std::byte(0) && input[offset + 1] == std::byte(0))
+				{
+					reader.skip(offset + sizeof(char16_t));
+
+					return event_views::utf16_view(input.first(offset));
+				}
+			}
+
+			reader.skip(size(input));
+
+			return event_views::utf16_view(input);
+		}
+
+		template <typename T>
+		std::optional<T> read_variable_view(span_reader& reader)
+		{
+			T event;
+
+			uint64_t unicode_name_length;
+			uint64_t variable_data_length;
+
+			if (!reader.read(&event.variable_name, sizeof(event.variable_name)) ||
+				!reader.read(&unicode_name_length, sizeof(unicode_name_length)) ||
+				!reader.read(&variable_data_length, sizeof(variable_data_length)))
+			{
+				return {};
+			}
+
+			if (unicode_name_length > size(reader.remaining()) / sizeof(char16_t))
+			{
+				return {};
+			}
+
+			event.unicode_name = event_views::utf16_view(reader.take(unicode_name_length * sizeof(char16_t)));
+			event.variable_data = reader.take(variable_data_length);
+
+			if (!reader.good())
+			{
+				return {};
+			}
+
+			return event;
+		}
+
+		template <typename T>
+		std::optional<T> read_image_view(span_reader& reader)
+		{
+			T event;
+
+			uint64_t size_of_device_path;
+
+			if (!reader.read(&event.image_location_in_memory, sizeof(event.image_location_in_memory)) ||
+				!reader.read(&event.image_length_in_memory, sizeof(event.image_length_in_memory)) ||
+				!reader.read(&event.image_link_time_address, sizeof(event.image_link_time_address)) ||
+				!reader.read(&size_of_device_path, sizeof(size_of_device_path)))
+			{
+				return {};
+			}
+
+			if (size_of_device_path)
+			{
+				event.device_path =
+					device_path_view(reader.take(std::min<uint64_t>(size_of_device_path, size(reader.remaining()))));
+			}
+
+			return event;
+		}
+
+		template <typename T>
+		std::optional<T> read_string_or_blob_view(span_reader& reader, std::span<const std::byte> buffer)
+		{
+			auto is_printable = [](auto character) {
+				return std::isprint(static_cast<char>(character));
+			};
+
+			if (std::ranges::all_of(buffer, is_printable))
+			{
+				return T {
+					.data = read_text(buffer),
+				};
+			}
+
+			if (size(buffer) == sizeof(events::uefi_blob_1))
+			{
+				events::uefi_blob_1 blob;
+
+				if (!reader.read(&blob, sizeof(blob)))
+				{
+					return {};
+				}
+
+				return T {
+					.data = blob,
+				};
+			}
+
+			event_views::uefi_blob_2 blob;
+
+			uint8_t description_size;
+
+			if (!reader.read(&description_size, sizeof(description_size)))
+			{
+				return {};
+			}
+
+			blob.blob_description = read_text(reader.take(description_size));
+
+			if (!reader.read(&blob.blob_base, sizeof(blob.blob_base)) ||
+				!reader.read(&blob.blob_length, sizeof(blob.blob_length)))
+			{
+				return {};
+			}
+
+			return T {
+				.data = blob,
+			};
+		}
+	} // namespace details
+
+	// Decodes the payload of an event and calls handler(view, payload) with the borrowed view type matching the
+	// event, without materializing an event_payload_t. Payloads that cannot be decoded are passed as raw bytes.
+	void visit_event_payload(const tcg_pgr_event_2_view& view, auto&& handler)
+	{
+		details::span_reader reader(view.event);
+
+		auto dispatch = [&](auto&& event) {
+			if (event)
+			{
+				handler(view, *event);
+			}
+			else
+			{
+				handler(view, event_views::raw_event_t(view.event));
+			}
+		};
+
+		switch (view.event_type)
+		{
+		case EV_S_CRTM_VERSION:
+			handler(view, event_views::s_crtm_version { .data = details::read_utf16(reader) });
+			return;
+		case EV_EFI_HCRTM_EVENT:
+			dispatch(details::read_string_or_blob_view<event_views::efi_hcrtm>(reader, view.event));
+			return;
+		case EV_EFI_PLATFORM_FIRMWARE_BLOB:
+			dispatch(details::read_struct<event_views::efi_platform_firmware_blob>(reader));
+			return;
+		case EV_EFI_VARIABLE_DRIVER_CONFIG:
+			dispatch(details::read_variable_view<event_views::efi_variable_driver_config>(reader));
+			return;
+		case EV_EFI_BOOT_SERVICES_APPLICATION:
+			dispatch(details::read_image_view<event_views::efi_boot_services_application>(reader));
+			return;
+		case EV_EFI_BOOT_SERVICES_DRIVER:
+			dispatch(details::read_image_view<event_views::efi_boot_services_driver>(reader));
+			return;
+		case EV_EFI_RUNTIME_SERVICES_DRIVER:
+			dispatch(details::read_image_view<event_views::efi_runtime_services_driver>(reader));
+			return;
+		case EV_EFI_VARIABLE_BOOT:
+			dispatch(details::read_variable_view<event_views::efi_variable_boot>(reader));
+			return;
+		case EV_POST_CODE:
+			dispatch(details::read_string_or_blob_view<event_views::post_code>(reader, view.event));
+			return;
+		case EV_EFI_ACTION:
+			handler(view, event_views::efi_action { .data = details::read_text(view.event) });
+			return;
+		case EV_IPL:
+			handler(view, event_views::ipl { .data = details::read_utf16(reader) });
+			return;
+		case EV_SEPARATOR:
+			handler(view, event_views::separator {});
+			return;
+		case EV_EFI_VARIABLE_AUTHORITY:
+			dispatch(details::read_variable_view<event_views::efi_variable_authority>(reader));
+			return;
+		}
+
+		handler(view, event_views::raw_event_t(view.event));
+	}
+
+	// Frames every remaining event of the input and visits its payload, stopping at the first event that cannot be
+	// framed. The input is advanced past the visited events.
+	void visit_events_2(
+		std::span<const std::byte>& input,
+		const std::vector<events::efi_spec_id::digest_size>& digest_sizes,
+		auto&& handler
+	)
+	{
+		event_framer framer(digest_sizes);
+
+		while (auto view = framer(input))
+		{
+			visit_event_payload(*view, handler);
+		}
+	}
+} // namespace tcg_parser
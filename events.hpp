@@ -20,6 +20,8 @@ namespace tcg_parser
 			{
 				uint16_t hash_alg;
 				uint16_t digest_size;
+
+				bool operator==(const struct digest_size&) const = default;
 			};
 
 			std::array<char, 16> signature;
@@ -30,6 +32,8 @@ namespace tcg_parser
 			uint8_t uint_n_size;
 			std::vector<digest_size> digest_sizes;
 			std::string vendor_info;
+
+			bool operator==(const efi_spec_id&) const = default;
 		};
 
 		struct uefi_image_load
@@ -37,7 +41,9 @@ namespace tcg_parser
 			uint64_t image_location_in_memory;
 			uint64_t image_length_in_memory;
 			uint64_t image_link_time_address;
-			std::vector<device_path_t> device_path;
+			device_path_buffer device_path;
+
+			bool operator==(const uefi_image_load&) const = default;
 		};
 
 		struct efi_boot_services_application : uefi_image_load
@@ -57,17 +63,23 @@ namespace tcg_parser
 			std::string blob_description;
 			uint64_t blob_base;
 			uint64_t blob_length;
+
+			bool operator==(const uefi_blob_2&) const = default;
 		};
 
 		struct uefi_blob_1
 		{
 			uint64_t blob_base;
 			uint64_t blob_length;
+
+			bool operator==(const uefi_blob_1&) const = default;
 		};
 
 		struct post_code
 		{
 			std::variant<std::string, uefi_blob_1, uefi_blob_2> data;
+
+			bool operator==(const post_code&) const = default;
 		};
 
 		struct efi_variable_base
@@ -75,6 +87,8 @@ namespace tcg_parser
 			std::array<uint8_t, 16> variable_name;
 			std::u16string unicode_name;
 			std::vector<uint8_t> variable_data;
+
+			bool operator==(const efi_variable_base&) const = default;
 		};
 
 		struct efi_variable_boot : efi_variable_base
@@ -92,11 +106,15 @@ namespace tcg_parser
 		struct efi_action
 		{
 			std::string data;
+
+			bool operator==(const efi_action&) const = default;
 		};
 
 		struct ipl
 		{
 			std::string data;
+
+			bool operator==(const ipl&) const = default;
 		};
 
 		struct efi_platform_firmware_blob : uefi_blob_1
@@ -106,15 +124,20 @@ namespace tcg_parser
 		struct s_crtm_version
 		{
 			std::u16string data;
+
+			bool operator==(const s_crtm_version&) const = default;
 		};
 
 		struct efi_hcrtm
 		{
 			std::variant<std::string, uefi_blob_1, uefi_blob_2> data;
+
+			bool operator==(const efi_hcrtm&) const = default;
 		};
 
 		struct separator
 		{
+			bool operator==(const separator&) const = default;
 		};
 
 		using raw_event_t = std::string;
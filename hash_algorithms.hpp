@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+using namespace std::string_view_literals;
+
+namespace tcg_parser
+{
+	enum hash_alg : uint16_t
+	{
+		TPM_ALG_SHA1 = 0x0004,
+		TPM_ALG_SHA256 = 0x000B,
+		TPM_ALG_SHA384 = 0x000C,
+		TPM_ALG_SHA512 = 0x000D,
+		TPM_ALG_SM3_256 = 0x0012,
+	};
+
+	// Returns zero for algorithms that are not known at compile time
+	constexpr uint16_t digest_size(uint16_t hash_alg)
+	{
+		switch (hash_alg)
+		{
+		case TPM_ALG_SHA1:
+			return 20;
+		case TPM_ALG_SHA256:
+			return 32;
+		case TPM_ALG_SHA384:
+			return 48;
+		case TPM_ALG_SHA512:
+			return 64;
+		case TPM_ALG_SM3_256:
+			return 32;
+		}
+
+		return 0;
+	}
+
+	constexpr std::string_view hash_alg_name(uint16_t hash_alg)
+	{
+		switch (hash_alg)
+		{
+		case TPM_ALG_SHA1:
+			return "sha1"sv;
+		case TPM_ALG_SHA256:
+			return "sha256"sv;
+		case TPM_ALG_SHA384:
+			return "sha384"sv;
+		case TPM_ALG_SHA512:
+			return "sha512"sv;
+		case TPM_ALG_SM3_256:
+			return "sm3_256"sv;
+		}
+
+		return {};
+	}
+} // namespace tcg_parser
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <format>
+#include <span>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#include "digest_bank.hpp"
+
+namespace tcg_parser
+{
+	namespace details
+	{
+		constexpr char hex_digits[] = "0123456789abcdef";
+
+		char* to_hex_scalar(const std::byte* input, std::size_t size, char* out)
+		{
+			for (std::size_t i = 0; i < size; i++)
+			{
+				auto value = std::to_integer<uint8_t>(input[i]);
+
+				*out++ = hex_digits[value >> 4];
+				*out++ = hex_digits[value & 0xf];
+			}
+
+			return out;
+		}
+
+#if defined(__x86_64__) || defined(__i386__)
+		__attribute__((target("ssse3"))) char* to_hex_ssse3(const std::byte* input, std::size_t size, char* out)
+		{
+			auto digits = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hex_digits));
+			auto mask = _mm_set1_epi8(0xf);
+
+			for (; size >= 16; size -= 16, input += 16, out += 32)
+			{
+				auto value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input));
+				auto high = _mm_shuffle_epi8(digits, _mm_and_si128(_mm_srli_epi16(value, 4), mask));
+				auto low = _mm_shuffle_epi8(digits, _mm_and_si128(value, mask));
+
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_unpacklo_epi8(high, low));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(out + 16), _mm_unpackhi_epi8(high, low));
+			}
+
+			return to_hex_scalar(input, size, out);
+		}
+
+		__attribute__((target("avx2"))) char* to_hex_avx2(const std::byte* input, std::size_t size, char* out)
+		{
+			auto digits = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(hex_digits)));
+			auto mask = _mm256_set1_epi8(0xf);
+
+			for (; size >= 32; size -= 32, input += 32, out += 64)
+			{
+				auto value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input));
+				auto high = _mm256_shuffle_epi8(digits, _mm256_and_si256(_mm256_srli_epi16(value, 4), mask));
+				auto low = _mm256_shuffle_epi8(digits, _mm256_and_si256(value, mask));
+
+				// Unpacking works within each 128-bit lane, so the halves have to be put back in order
+				auto first = _mm256_unpacklo_epi8(high, low);
+				auto second = _mm256_unpackhi_epi8(high, low);
+
+				auto output = reinterpret_cast<__m256i*>(out);
+
+				_mm256_storeu_si256(output, _mm256_permute2x128_si256(first, second, 0x20));
+				_mm256_storeu_si256(output + 1, _mm256_permute2x128_si256(first, second, 0x31));
+			}
+
+			// The SSSE3 kernel is not VEX encoded and would pay for the dirty upper halves on every instruction
+			_mm256_zeroupper();
+
+			return to_hex_ssse3(input, size, out);
+		}
+#endif
+
+		using to_hex_t = char* (*)(const std::byte*, std::size_t, char*);
+
+		to_hex_t select_to_hex()
+		{
+#if defined(__x86_64__) || defined(__i386__)
+			if (__builtin_cpu_supports("avx2"))
+			{
+				return to_hex_avx2;
+			}
+
+			if (__builtin_cpu_supports("ssse3"))
+			{
+				return to_hex_ssse3;
+			}
+#endif
+
+			return to_hex_scalar;
+		}
+	} // namespace details
+
+	// Writes two lowercase hex digits per input byte to out and returns the end of the output.
+	// Uses the widest vector kernel the CPU supports.
+	char* to_hex(std::span<const std::byte> input, char* out)
+	{
+		static const auto kernel = details::select_to_hex();
+
+		return kernel(input.data(), size(input), out);
+	}
+
+	std::string to_hex(std::span<const std::byte> input)
+	{
+		std::string result(size(input) * 2, '\0');
+
+		to_hex(input, result.data());
+
+		return result;
+	}
+} // namespace tcg_parser
+
+template <>
+struct std::formatter<tcg_parser::digest_view, char>
+{
+	constexpr auto parse(std::format_parse_context& context)
+	{
+		return context.begin();
+	}
+
+	auto format(tcg_parser::digest_view digest, std::format_context& context) const
+	{
+		char buffer[tcg_parser::digest::max_size * 2];
+
+		auto end = tcg_parser::to_hex(digest.bytes(), buffer);
+
+		return std::copy(buffer, end, context.out());
+	}
+};
+
+template <>
+struct std::formatter<tcg_parser::digest, char> : std::formatter<tcg_parser::digest_view, char>
+{
+};
@@ -0,0 +1,363 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <shared_mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "tcg_parser.hpp"
+
+namespace tcg_parser
+{
+	template <typename T, std::size_t ShardCount>
+	class intern_table;
+
+	// Refers to a value held by an intern_table. Equal values interned in the same table share a single copy, so
+	// handles compare by address.
+	template <typename T>
+	class interned
+	{
+	public:
+		interned() = default;
+
+		const T& operator*() const
+		{
+			return *m_value;
+		}
+
+		const T* operator->() const
+		{
+			return m_value;
+		}
+
+		const T* get() const
+		{
+			return m_value;
+		}
+
+		explicit operator bool() const
+		{
+			return m_value != nullptr;
+		}
+
+		bool operator==(const interned& other) const = default;
+
+	private:
+		template <typename, std::size_t>
+		friend class intern_table;
+
+		explicit interned(const T* value)
+			: m_value(value)
+		{
+		}
+
+		const T* m_value = nullptr;
+	};
+
+	namespace details
+	{
+		std::size_t hash_bytes(std::span<const std::byte> bytes)
+		{
+			auto text = std::string_view(reinterpret_cast<const char*>(bytes.data()), size(bytes));
+
+			return std::hash<std::string_view>()(text);
+		}
+
+		struct intern_hash
+		{
+			std::size_t operator()(const digest_bank& digests) const
+			{
+				std::size_t hash = digests.size();
+
+				for (auto digest : digests)
+				{
+					hash = hash * 31 + (hash_bytes(digest.bytes()) ^ digest.hash_alg());
+				}
+
+				return hash;
+			}
+
+			std::size_t operator()(const device_path_buffer& path) const
+			{
+				return hash_bytes(path.bytes());
+			}
+
+			std::size_t operator()(const std::u16string& text) const
+			{
+				return hash_bytes(std::as_bytes(std::span(text)));
+			}
+
+			std::size_t operator()(const std::vector<uint8_t>& data) const
+			{
+				return hash_bytes(std::as_bytes(std::span(data)));
+			}
+		};
+	} // namespace details
+
+	// Stores each distinct value once and hands out handles to it. Values are spread over shards by their hash, each
+	// with its own lock, so threads interning different values rarely wait for each other and lookups of values that
+	// are already present only take a shared lock. Handles stay valid for as long as the table.
+	template <typename T, std::size_t ShardCount = 64>
+	class intern_table
+	{
+	public:
+		intern_table() = default;
+
+		intern_table(const intern_table&) = delete;
+
+		intern_table& operator=(const intern_table&) = delete;
+
+		interned<T> intern(const T& value)
+		{
+			return insert(value);
+		}
+
+		interned<T> intern(T&& value)
+		{
+			return insert(std::move(value));
+		}
+
+		// The number of distinct values
+		std::size_t size() const
+		{
+			std::size_t count = 0;
+
+			for (auto& shard : m_shards)
+			{
+				std::shared_lock lock(shard.mutex);
+
+				count += std::size(shard.values);
+			}
+
+			return count;
+		}
+
+	private:
+		template <typename U>
+		interned<T> insert(U&& value)
+		{
+			auto& shard = m_shards[details::intern_hash()(value) % ShardCount];
+
+			{
+				std::shared_lock lock(shard.mutex);
+
+				if (auto entry = shard.values.find(value); entry != end(shard.values))
+				{
+					return interned<T>(&*entry);
+				}
+			}
+
+			std::unique_lock lock(shard.mutex);
+
+			// Elements of an unordered_set never move, so their addresses serve as handles
+			auto [entry, inserted] = shard.values.insert(std::forward<U>(value));
+
+			return interned<T>(&*entry);
+		}
+
+		struct shard
+		{
+			mutable std::shared_mutex mutex;
+			std::unordered_set<T, details::intern_hash> values;
+		};
+
+		std::array<shard, ShardCount> m_shards;
+	};
+
+	// Counterparts of the payloads in events.hpp whose large, frequently repeated members are interned
+	namespace interned_events
+	{
+		struct uefi_image_load
+		{
+			uint64_t image_location_in_memory;
+			uint64_t image_length_in_memory;
+			uint64_t image_link_time_address;
+			interned<device_path_buffer> device_path;
+		};
+
+		struct efi_boot_services_application : uefi_image_load
+		{
+		};
+
+		struct efi_boot_services_driver : uefi_image_load
+		{
+		};
+
+		struct efi_runtime_services_driver : uefi_image_load
+		{
+		};
+
+		struct efi_variable_base
+		{
+			std::array<uint8_t, 16> variable_name;
+			interned<std::u16string> unicode_name;
+			interned<std::vector<uint8_t>> variable_data;
+		};
+
+		struct efi_variable_boot : efi_variable_base
+		{
+		};
+
+		struct efi_variable_driver_config : efi_variable_base
+		{
+		};
+
+		struct efi_variable_authority : efi_variable_base
+		{
+		};
+
+		using events::efi_action;
+		using events::efi_hcrtm;
+		using events::efi_platform_firmware_blob;
+		using events::efi_spec_id;
+		using events::ipl;
+		using events::post_code;
+		using events::raw_event_t;
+		using events::s_crtm_version;
+		using events::separator;
+	} // namespace interned_events
+
+	using interned_payload_t = std::variant<
+		interned_events::raw_event_t,
+		interned_events::s_crtm_version,
+		interned_events::efi_spec_id,
+		interned_events::efi_boot_services_application,
+		interned_events::efi_variable_boot,
+		interned_events::efi_platform_firmware_blob,
+		interned_events::efi_variable_driver_config,
+		interned_events::efi_boot_services_driver,
+		interned_events::efi_runtime_services_driver,
+		interned_events::post_code,
+		interned_events::efi_action,
+		interned_events::ipl,
+		interned_events::separator,
+		interned_events::efi_hcrtm,
+		interned_events::efi_variable_authority>;
+
+	struct interned_event_2
+	{
+		uint32_t pcr_index;
+		uint32_t event_type;
+		interned<digest_bank> digests;
+		interned_payload_t event;
+	};
+
+	// Interns the digest banks, device paths, variable names and variable data of events, so that events of many
+	// logs share a single copy of each. Can be used from several threads at once.
+	class event_interner
+	{
+	public:
+		interned_event_2 intern(const tcg_pgr_event_2& event)
+		{
+			return {
+				.pcr_index = event.pcr_index,
+				.event_type = event.event_type,
+				.digests = m_digests.intern(event.digests),
+				.event = std::visit(
+					[this](const auto& payload) -> interned_payload_t {
+						return intern_payload(payload);
+					},
+					event.event
+				),
+			};
+		}
+
+		const intern_table<digest_bank>& digests() const
+		{
+			return m_digests;
+		}
+
+		const intern_table<device_path_buffer>& device_paths() const
+		{
+			return m_device_paths;
+		}
+
+		const intern_table<std::u16string>& unicode_names() const
+		{
+			return m_unicode_names;
+		}
+
+		const intern_table<std::vector<uint8_t>>& variable_data() const
+		{
+			return m_variable_data;
+		}
+
+	private:
+		template <typename T>
+		T intern_image(const events::uefi_image_load& event)
+		{
+			T result;
+
+			result.image_location_in_memory = event.image_location_in_memory;
+			result.image_length_in_memory = event.image_length_in_memory;
+			result.image_link_time_address = event.image_link_time_address;
+			result.device_path = m_device_paths.intern(event.device_path);
+
+			return result;
+		}
+
+		template <typename T>
+		T intern_variable(const events::efi_variable_base& event)
+		{
+			T result;
+
+			result.variable_name = event.variable_name;
+			result.unicode_name = m_unicode_names.intern(event.unicode_name);
+			result.variable_data = m_variable_data.intern(event.variable_data);
+
+			return result;
+		}
+
+		// Payloads without interned members are copied as they are
+		const auto& intern_payload(const auto& payload)
+		{
+			return payload;
+		}
+
+		interned_events::efi_boot_services_application intern_payload(
+			const events::efi_boot_services_application& event
+		)
+		{
+			return intern_image<interned_events::efi_boot_services_application>(event);
+		}
+
+		interned_events::efi_boot_services_driver intern_payload(const events::efi_boot_services_driver& event)
+		{
+			return intern_image<interned_events::efi_boot_services_driver>(event);
+		}
+
+		interned_events::efi_runtime_services_driver intern_payload(const events::efi_runtime_services_driver& event)
+		{
+			return intern_image<interned_events::efi_runtime_services_driver>(event);
+		}
+
+		interned_events::efi_variable_boot intern_payload(const events::efi_variable_boot& event)
+		{
+			return intern_variable<interned_events::efi_variable_boot>(event);
+		}
+
+		interned_events::efi_variable_driver_config intern_payload(const events::efi_variable_driver_config& event)
+		{
+			return intern_variable<interned_events::efi_variable_driver_config>(event);
+		}
+
+		interned_events::efi_variable_authority intern_payload(const events::efi_variable_authority& event)
+		{
+			return intern_variable<interned_events::efi_variable_authority>(event);
+		}
+
+		intern_table<digest_bank> m_digests;
+		intern_table<device_path_buffer> m_device_paths;
+		intern_table<std::u16string> m_unicode_names;
+		intern_table<std::vector<uint8_t>> m_variable_data;
+	};
+} // namespace tcg_parser
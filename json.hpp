@@ -0,0 +1,668 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+#include "buffered_writer.hpp"
+#include "event_views.hpp"
+#include "hex.hpp"
+#include "tcg_parser.hpp"
+
+namespace tcg_parser
+{
+	enum class json_layout
+	{
+		// One object per line
+		ndjson,
+		// A single array holding every object
+		array,
+	};
+
+	// Writes events as JSON objects holding the header, every digest bank and the decoded payload.
+	// Accepts both materialized events and the borrowed payloads of visit_events_2, so it can be used as its handler.
+	class json_serializer
+	{
+	public:
+		explicit json_serializer(buffered_writer& writer, json_layout layout = json_layout::ndjson)
+			: m_writer(writer)
+			, m_layout(layout)
+		{
+		}
+
+		// The digest sizes of the spec ID event are kept to split the digests of tcg_pgr_event_2_view
+		void operator()(const tcg_pgr_event_1& event)
+		{
+			if (auto spec_event = std::get_if<events::efi_spec_id>(&event.event))
+			{
+				m_digest_sizes = spec_event->digest_sizes;
+			}
+
+			begin_event(event.pcr_index, event.event_type);
+
+			key("digests");
+			begin_object();
+			key(hash_alg_name(TPM_ALG_SHA1));
+			hex(std::as_bytes(std::span(event.digest)));
+			end_object();
+
+			payload(event.event);
+			end_event();
+		}
+
+		void operator()(const tcg_pgr_event_2& event)
+		{
+			begin_event(event.pcr_index, event.event_type);
+
+			key("digests");
+			begin_object();
+
+			for (auto digest : event.digests)
+			{
+				digest_key(digest.hash_alg());
+				hex(digest.bytes());
+			}
+
+			end_object();
+
+			payload(event.event);
+			end_event();
+		}
+
+		void operator()(const tcg_pgr_event_2_view& view, const auto& event)
+		{
+			begin_event(view.pcr_index, view.event_type);
+
+			key("digests");
+			begin_object();
+
+			details::for_each_digest(
+				view,
+				m_digest_sizes,
+				[this](uint16_t hash_alg, std::span<const std::byte> digest) {
+					digest_key(hash_alg);
+					hex(digest);
+				}
+			);
+
+			end_object();
+
+			key("event");
+			begin_object();
+			fields(event);
+			end_object();
+
+			end_event();
+		}
+
+		// Closes the array of json_layout::array. Nothing is written for json_layout::ndjson.
+		void finish()
+		{
+			if (m_layout == json_layout::array)
+			{
+				m_writer.write(m_events ? "\n]\n"sv : "[]\n"sv);
+			}
+		}
+
+	private:
+		void begin_event(uint32_t pcr_index, uint32_t event_type)
+		{
+			if (m_layout == json_layout::array)
+			{
+				m_writer.write(m_events ? ",\n"sv : "[\n"sv);
+			}
+
+			m_events++;
+
+			begin_object();
+
+			key("pcr_index");
+			m_writer.write(pcr_index);
+			m_separate = true;
+
+			key("event_type");
+			m_writer.write(event_type);
+			m_separate = true;
+
+			if (auto name = to_string(event_type); !name.empty())
+			{
+				key("event_type_name");
+				string(name);
+			}
+		}
+
+		void end_event()
+		{
+			end_object();
+
+			if (m_layout == json_layout::ndjson)
+			{
+				m_writer.push_back('\n');
+			}
+		}
+
+		void payload(const event_payload_t& event)
+		{
+			key("event");
+			begin_object();
+
+			std::visit(
+				[this](const auto& event) {
+					fields(event);
+				},
+				event
+			);
+
+			end_object();
+		}
+
+		void begin_object()
+		{
+			m_writer.push_back('{');
+			m_separate = false;
+		}
+
+		void end_object()
+		{
+			m_writer.push_back('}');
+			m_separate = true;
+		}
+
+		void begin_array()
+		{
+			m_writer.push_back('[');
+			m_separate = false;
+		}
+
+		void end_array()
+		{
+			m_writer.push_back(']');
+			m_separate = true;
+		}
+
+		void element()
+		{
+			if (m_separate)
+			{
+				m_writer.push_back(',');
+			}
+		}
+
+		// Keys are always plain ASCII and never need escaping
+		void key(std::string_view name)
+		{
+			element();
+
+			m_writer.push_back('"');
+			m_writer.write(name);
+			m_writer.write("\":"sv);
+
+			m_separate = false;
+		}
+
+		void digest_key(uint16_t hash_alg)
+		{
+			if (auto name = hash_alg_name(hash_alg); !name.empty())
+			{
+				key(name);
+			}
+			else
+			{
+				element();
+
+				std::format_to(std::back_inserter(m_writer), "\"0x{:04x}\":", hash_alg);
+
+				m_separate = false;
+			}
+		}
+
+		void number(uint64_t value)
+		{
+			element();
+
+			m_writer.write(value);
+			m_separate = true;
+		}
+
+		// Bytes outside of printable ASCII are escaped one by one, as the log does not say which encoding they are in
+		void string(std::string_view text)
+		{
+			element();
+
+			m_writer.push_back('"');
+
+			auto is_plain = [](char character) {
+				return character >= 0x20 && character < 0x7f && character != '"' && character != '\\';
+			};
+
+			while (!text.empty())
+			{
+				std::size_t plain = std::ranges::find_if_not(text, is_plain) - text.begin();
+
+				m_writer.write(text.substr(0, plain));
+
+				if (plain == text.size())
+				{
+					break;
+				}
+
+				escape(static_cast<uint8_t>(text[plain]));
+
+				text.remove_prefix(plain + 1);
+			}
+
+			m_writer.push_back('"');
+			m_separate = true;
+		}
+
+		// Writes UTF-16 text as UTF-8. Unpaired surrogates become U+FFFD.
+		void utf16(const auto& text)
+		{
+			element();
+
+			m_writer.push_back('"');
+
+			char32_t high_surrogate = 0;
+
+			for (char32_t character : text)
+			{
+				if (high_surrogate)
+				{
+					if (character >= 0xdc00 && character < 0xe000)
+					{
+						character = 0x10000 + ((high_surrogate - 0xd800) << 10) + (character - 0xdc00);
+						high_surrogate = 0;
+
+						utf8(character);
+
+						continue;
+					}
+
+					high_surrogate = 0;
+
+					utf8(0xfffd);
+				}
+
+				if (character >= 0xd800 && character < 0xdc00)
+				{
+					high_surrogate = character;
+				}
+				else if (character >= 0xdc00 && character < 0xe000)
+				{
+					utf8(0xfffd);
+				}
+				else if (character < 0x20 || character == '"' || character == '\\')
+				{
+					escape(character);
+				}
+				else
+				{
+					utf8(character);
+				}
+			}
+
+			if (high_surrogate)
+			{
+				utf8(0xfffd);
+			}
+
+			m_writer.push_back('"');
+			m_separate = true;
+		}
+
+		void utf8(char32_t character)
+		{
+			if (character < 0x80)
+			{
+				m_writer.push_back(static_cast<char>(character));
+			}
+			else if (character < 0x800)
+			{
+				m_writer.push_back(static_cast<char>(0xc0 | (character >> 6)));
+				m_writer.push_back(static_cast<char>(0x80 | (character & 0x3f)));
+			}
+			else if (character < 0x10000)
+			{
+				m_writer.push_back(static_cast<char>(0xe0 | (character >> 12)));
+				m_writer.push_back(static_cast<char>(0x80 | ((character >> 6) & 0x3f)));
+				m_writer.push_back(static_cast<char>(0x80 | (character & 0x3f)));
+			}
+			else
+			{
+				m_writer.push_back(static_cast<char>(0xf0 | (character >> 18)));
+				m_writer.push_back(static_cast<char>(0x80 | ((character >> 12) & 0x3f)));
+				m_writer.push_back(static_cast<char>(0x80 | ((character >> 6) & 0x3f)));
+				m_writer.push_back(static_cast<char>(0x80 | (character & 0x3f)));
+			}
+		}
+
+		void escape(char32_t character)
+		{
+			switch (character)
+			{
+			case '"':
+				m_writer.write("\\\""sv);
+				return;
+			case '\\':
+				m_writer.write("\\\\"sv);
+				return;
+			case '\n':
+				m_writer.write("\\n"sv);
+				return;
+			case '\r':
+				m_writer.write("\\r"sv);
+				return;
+			case '\t':
+				m_writer.write("\\t"sv);
+				return;
+			}
+
+			auto buffer = m_writer.prepare(6);
+
+			buffer[0] = '\\';
+			buffer[1] = 'u';
+			buffer[2] = '0';
+			buffer[3] = '0';
+			buffer[4] = details::hex_digits[(character >> 4) & 0xf];
+			buffer[5] = details::hex_digits[character & 0xf];
+
+			m_writer.commit(6);
+		}
+
+		void hex(std::span<const std::byte> bytes)
+		{
+			element();
+
+			m_writer.push_back('"');
+
+			// Large payloads are encoded in pieces that fit into the writer
+			auto piece = m_writer.capacity() / 2;
+
+			while (!bytes.empty())
+			{
+				auto count = std::min(piece, size(bytes));
+				auto buffer = m_writer.prepare(count * 2);
+
+				to_hex(bytes.first(count), buffer.data());
+
+				m_writer.commit(count * 2);
+
+				bytes = bytes.subspan(count);
+			}
+
+			m_writer.push_back('"');
+			m_separate = true;
+		}
+
+		void guid(const std::array<uint8_t, 16>& guid)
+		{
+			element();
+
+			std::format_to(
+				std::back_inserter(m_writer),
+				"\"{:02x}{:02x}{:02x}{:02x}-{:02x}{:02x}-{:02x}{:02x}-{:02x}{:02x}-{:02x}{:02x}{:02x}{:02x}{:02x}"
+				"{:02x}\"",
+				guid[3],
+				guid[2],
+				guid[1],
+				guid[0],
+				guid[5],
+				guid[4],
+				guid[7],
+				guid[6],
+				guid[8],
+				guid[9],
+				guid[10],
+				guid[11],
+				guid[12],
+				guid[13],
+				guid[14],
+				guid[15]
+			);
+
+			m_separate = true;
+		}
+
+		void device_path(device_path_view path)
+		{
+			m_scratch.clear();
+
+			std::format_to(std::back_inserter(m_scratch), "{}", path);
+
+			string(m_scratch);
+		}
+
+		void fields(const events::raw_event_t& event)
+		{
+			fields(std::as_bytes(std::span(event)));
+		}
+
+		void fields(std::span<const std::byte> event)
+		{
+			key("data");
+			hex(event);
+		}
+
+		void fields(const events::efi_spec_id& event)
+		{
+			key("signature");
+			string(std::string_view(event.signature.data(), std::ranges::find(event.signature, '\0')));
+
+			key("platform_class");
+			number(event.platform_class);
+
+			key("spec_version_major");
+			number(event.spec_version_major);
+
+			key("spec_version_minor");
+			number(event.spec_version_minor);
+
+			key("spec_errata");
+			number(event.spec_errata);
+
+			key("uint_n_size");
+			number(event.uint_n_size);
+
+			key("digest_sizes");
+			begin_array();
+
+			for (auto entry : event.digest_sizes)
+			{
+				element();
+				begin_object();
+
+				key("hash_alg");
+				number(entry.hash_alg);
+
+				if (auto name = hash_alg_name(entry.hash_alg); !name.empty())
+				{
+					key("hash_alg_name");
+					string(name);
+				}
+
+				key("digest_size");
+				number(entry.digest_size);
+
+				end_object();
+			}
+
+			end_array();
+
+			key("vendor_info");
+			string(event.vendor_info);
+		}
+
+		void fields(const events::s_crtm_version& event)
+		{
+			key("data");
+			utf16(event.data);
+		}
+
+		void fields(const event_views::s_crtm_version& event)
+		{
+			key("data");
+			utf16(event.data);
+		}
+
+		void image_fields(const auto& event)
+		{
+			key("image_location_in_memory");
+			number(event.image_location_in_memory);
+
+			key("image_length_in_memory");
+			number(event.image_length_in_memory);
+
+			key("image_link_time_address");
+			number(event.image_link_time_address);
+
+			key("device_path");
+			device_path(event.device_path);
+		}
+
+		void fields(const events::uefi_image_load& event)
+		{
+			image_fields(event);
+		}
+
+		void fields(const event_views::uefi_image_load& event)
+		{
+			image_fields(event);
+		}
+
+		void variable_fields(const auto& event)
+		{
+			key("variable_name");
+			guid(event.variable_name);
+
+			key("unicode_name");
+			utf16(event.unicode_name);
+
+			key("variable_data");
+			hex(std::as_bytes(std::span(event.variable_data)));
+		}
+
+		void fields(const events::efi_variable_base& event)
+		{
+			variable_fields(event);
+		}
+
+		void fields(const event_views::efi_variable_base& event)
+		{
+			variable_fields(event);
+		}
+
+		void fields(const events::uefi_blob_1& event)
+		{
+			key("blob_base");
+			number(event.blob_base);
+
+			key("blob_length");
+			number(event.blob_length);
+		}
+
+		void blob_2_fields(const auto& event)
+		{
+			key("blob_description");
+			string(event.blob_description);
+
+			key("blob_base");
+			number(event.blob_base);
+
+			key("blob_length");
+			number(event.blob_length);
+		}
+
+		void fields(const events::uefi_blob_2& event)
+		{
+			blob_2_fields(event);
+		}
+
+		void fields(const event_views::uefi_blob_2& event)
+		{
+			blob_2_fields(event);
+		}
+
+		// The text or blob of post code and H-CRTM events
+		template <typename... Types>
+		void fields(const std::variant<Types...>& data)
+		{
+			std::visit(
+				[this]<typename T>(const T& contents) {
+					if constexpr (std::is_convertible_v<const T&, std::string_view>)
+					{
+						key("data");
+						string(contents);
+					}
+					else
+					{
+						fields(contents);
+					}
+				},
+				data
+			);
+		}
+
+		void fields(const events::post_code& event)
+		{
+			fields(event.data);
+		}
+
+		void fields(const event_views::post_code& event)
+		{
+			fields(event.data);
+		}
+
+		void fields(const events::efi_hcrtm& event)
+		{
+			fields(event.data);
+		}
+
+		void fields(const event_views::efi_hcrtm& event)
+		{
+			fields(event.data);
+		}
+
+		void fields(const events::efi_action& event)
+		{
+			key("data");
+			string(event.data);
+		}
+
+		void fields(const event_views::efi_action& event)
+		{
+			key("data");
+			string(event.data);
+		}
+
+		void fields(const events::ipl& event)
+		{
+			key("data");
+			string(event.data);
+		}
+
+		void fields(const event_views::ipl& event)
+		{
+			key("data");
+			utf16(event.data);
+		}
+
+		void fields(const events::separator&)
+		{
+		}
+
+		buffered_writer& m_writer;
+		json_layout m_layout;
+		std::vector<events::efi_spec_id::digest_size> m_digest_sizes;
+		std::string m_scratch;
+		std::size_t m_events = 0;
+		bool m_separate = false;
+	};
+} // namespace tcg_parser
@@ -0,0 +1,563 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <random>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "tcg_parser.hpp"
+#include "writer.hpp"
+
+namespace tcg_parser
+{
+	// The kinds of events a synthetic log is made of
+	enum class synthetic_event
+	{
+		s_crtm_version,
+		post_code,
+		platform_firmware_blob,
+		boot_services_application,
+		boot_services_driver,
+		runtime_services_driver,
+		variable_boot,
+		variable_driver_config,
+		variable_authority,
+		efi_action,
+		ipl,
+		separator,
+		gpt,
+	};
+
+	constexpr std::array synthetic_events = {
+		synthetic_event::s_crtm_version,
+		synthetic_event::post_code,
+		synthetic_event::platform_firmware_blob,
+		synthetic_event::boot_services_application,
+		synthetic_event::boot_services_driver,
+		synthetic_event::runtime_services_driver,
+		synthetic_event::variable_boot,
+		synthetic_event::variable_driver_config,
+		synthetic_event::variable_authority,
+		synthetic_event::efi_action,
+		synthetic_event::ipl,
+		synthetic_event::separator,
+		synthetic_event::gpt,
+	};
+
+	constexpr std::string_view synthetic_event_name(synthetic_event kind)
+	{
+		switch (kind)
+		{
+		case synthetic_event::s_crtm_version:
+			return "s_crtm_version"sv;
+		case synthetic_event::post_code:
+			return "post_code"sv;
+		case synthetic_event::platform_firmware_blob:
+			return "platform_firmware_blob"sv;
+		case synthetic_event::boot_services_application:
+			return "boot_services_application"sv;
+		case synthetic_event::boot_services_driver:
+			return "boot_services_driver"sv;
+		case synthetic_event::runtime_services_driver:
+			return "runtime_services_driver"sv;
+		case synthetic_event::variable_boot:
+			return "variable_boot"sv;
+		case synthetic_event::variable_driver_config:
+			return "variable_driver_config"sv;
+		case synthetic_event::variable_authority:
+			return "variable_authority"sv;
+		case synthetic_event::efi_action:
+			return "efi_action"sv;
+		case synthetic_event::ipl:
+			return "ipl"sv;
+		case synthetic_event::separator:
+			return "separator"sv;
+		case synthetic_event::gpt:
+			return "gpt"sv;
+		}
+
+		return {};
+	}
+
+	struct log_generator_options
+	{
+		std::size_t event_count = 10000;
+
+		// How often each kind of event occurs relative to the others. The default is roughly what the firmware of a
+		// PC that boots Linux through shim and GRUB measures.
+		std::vector<std::pair<synthetic_event, unsigned>> mix = {
+			{ synthetic_event::s_crtm_version, 1 },
+			{ synthetic_event::post_code, 3 },
+			{ synthetic_event::platform_firmware_blob, 2 },
+			{ synthetic_event::boot_services_application, 4 },
+			{ synthetic_event::boot_services_driver, 6 },
+			{ synthetic_event::runtime_services_driver, 1 },
+			{ synthetic_event::variable_boot, 4 },
+			{ synthetic_event::variable_driver_config, 6 },
+			{ synthetic_event::variable_authority, 2 },
+			{ synthetic_event::efi_action, 2 },
+			{ synthetic_event::ipl, 8 },
+			{ synthetic_event::separator, 2 },
+			{ synthetic_event::gpt, 1 },
+		};
+
+		std::vector<uint16_t> hash_algs = { TPM_ALG_SHA1, TPM_ALG_SHA256 };
+
+		// The number of nodes in the device paths of image loads, not counting the end node
+		std::size_t device_path_depth = 5;
+
+		uint64_t seed = 1;
+	};
+
+	namespace details
+	{
+		// Makes up events one at a time. Random choices only use the raw output of the engine, whose sequence is
+		// fixed by the standard, so a seed produces the same events with every standard library.
+		class synthetic_event_source
+		{
+		public:
+			explicit synthetic_event_source(const log_generator_options& options)
+				: m_options(options)
+				, m_random(options.seed)
+			{
+				for (auto [kind, weight] : options.mix)
+				{
+					m_total_weight += weight;
+				}
+			}
+
+			tcg_pgr_event_1 spec_id_event() const
+			{
+				events::efi_spec_id spec {
+					.signature = { 'S', 'p', 'e', 'c', ' ', 'I', 'D', ' ', 'E', 'v', 'e', 'n', 't', '0', '3', '\0' },
+					.platform_class = 0,
+					.spec_version_minor = 0,
+					.spec_version_major = 2,
+					.spec_errata = 0,
+					.uint_n_size = 2,
+				};
+
+				for (auto hash_alg : m_options.hash_algs)
+				{
+					spec.digest_sizes.push_back({ hash_alg, digest_size(hash_alg) });
+				}
+
+				return {
+					.pcr_index = 0,
+					.event_type = EV_NO_ACTION,
+					.digest = {},
+					.event = spec,
+				};
+			}
+
+			// Returns false once the mix is empty
+			bool next_event(tcg_pgr_event_2& event)
+			{
+				if (!m_total_weight)
+				{
+					return false;
+				}
+
+				auto choice = next(m_total_weight);
+
+				for (auto [kind, weight] : m_options.mix)
+				{
+					if (choice < weight)
+					{
+						event = make_event(kind);
+
+						return true;
+					}
+
+					choice -= weight;
+				}
+
+				return false;
+			}
+
+		private:
+			static constexpr std::array<uint8_t, 16> global_variable = {
+				0x61, 0xdf, 0xe4, 0x8b, 0xca, 0x93, 0xd2, 0x11, 0xaa, 0x0d, 0x00, 0xe0, 0x98, 0x03, 0x2b, 0x8c,
+			};
+
+			static constexpr std::array<uint8_t, 16> image_security_database = {
+				0xcb, 0xb2, 0x19, 0xd7, 0x3a, 0x3d, 0x96, 0x45, 0xa3, 0xbc, 0xda, 0xd0, 0x0e, 0x67, 0x65, 0x6f,
+			};
+
+			static constexpr std::array secure_boot_variables = { "SecureBoot"sv, "PK"sv, "KEK"sv, "db"sv, "dbx"sv };
+
+			static constexpr std::array actions = {
+				"Calling EFI Application from Boot Option"sv,
+				"Returning from EFI Application from Boot Option"sv,
+				"Exit Boot Services Invocation"sv,
+				"Exit Boot Services Returned with Success"sv,
+			};
+
+			static constexpr std::array commands = {
+				"grub_cmd: linux /vmlinuz root=/dev/nvme0n1p2 ro quiet splash initrd="sv,
+				"grub_cmd: set root=hd0,gpt2 timeout="sv,
+				"kernel_cmdline: /vmlinuz root=/dev/nvme0n1p2 ro quiet splash resume="sv,
+			};
+
+			static constexpr std::array vendors = { "BOOT"sv, "ubuntu"sv, "fedora"sv, "Microsoft\\Boot"sv };
+
+			static constexpr std::array files = { "BOOTX64.EFI"sv, "shimx64.efi"sv, "grubx64.efi"sv, "mmx64.efi"sv };
+
+			// Returns a number below bound
+			uint64_t next(uint64_t bound)
+			{
+				return m_random() % bound;
+			}
+
+			std::string_view pick(const auto& values)
+			{
+				return values[next(size(values))];
+			}
+
+			template <typename T>
+			T random_bytes(std::size_t count)
+			{
+				T bytes(count, 0);
+
+				for (auto& byte : bytes)
+				{
+					byte = static_cast<typename T::value_type>(m_random());
+				}
+
+				return bytes;
+			}
+
+			static std::u16string to_utf16(std::string_view text)
+			{
+				return std::u16string(text.begin(), text.end());
+			}
+
+			tcg_pgr_event_2 make_event(synthetic_event kind)
+			{
+				tcg_pgr_event_2 event {};
+
+				for (auto hash_alg : m_options.hash_algs)
+				{
+					auto digest = random_bytes<std::vector<uint8_t>>(digest_size(hash_alg));
+
+					event.digests.push_back(hash_alg, std::as_bytes(std::span(digest)));
+				}
+
+				auto set = [&](uint32_t pcr_index, uint32_t event_type, auto payload) {
+					event.pcr_index = pcr_index;
+					event.event_type = event_type;
+					event.event = std::move(payload);
+				};
+
+				switch (kind)
+				{
+				case synthetic_event::s_crtm_version:
+				{
+					auto version = "Firmware Version 1." + std::to_string(next(100));
+
+					set(0, EV_S_CRTM_VERSION, events::s_crtm_version { to_utf16(version) });
+					break;
+				}
+				case synthetic_event::post_code:
+					if (next(2))
+					{
+						set(0, EV_POST_CODE, events::post_code { std::string(next(2) ? "ACPI DATA" : "SMBIOS DATA") });
+					}
+					else
+					{
+						set(0, EV_POST_CODE, events::post_code { blob() });
+					}
+					break;
+				case synthetic_event::platform_firmware_blob:
+					set(0, EV_EFI_PLATFORM_FIRMWARE_BLOB, events::efi_platform_firmware_blob { blob() });
+					break;
+				case synthetic_event::boot_services_application:
+					set(4, EV_EFI_BOOT_SERVICES_APPLICATION, image<events::efi_boot_services_application>());
+					break;
+				case synthetic_event::boot_services_driver:
+					set(2, EV_EFI_BOOT_SERVICES_DRIVER, image<events::efi_boot_services_driver>());
+					break;
+				case synthetic_event::runtime_services_driver:
+					set(2, EV_EFI_RUNTIME_SERVICES_DRIVER, image<events::efi_runtime_services_driver>());
+					break;
+				case synthetic_event::variable_boot:
+				{
+					auto name = next(4) ? "Boot000" + std::to_string(next(10)) : "BootOrder";
+
+					set(1, EV_EFI_VARIABLE_BOOT, variable<events::efi_variable_boot>(global_variable, name, 64));
+					break;
+				}
+				case synthetic_event::variable_driver_config:
+				{
+					auto name = pick(secure_boot_variables);
+
+					auto payload = variable<events::efi_variable_driver_config>(global_variable, name, 2048);
+
+					set(7, EV_EFI_VARIABLE_DRIVER_CONFIG, payload);
+					break;
+				}
+				case synthetic_event::variable_authority:
+				{
+					auto payload = variable<events::efi_variable_authority>(image_security_database, "db", 1536);
+
+					set(7, EV_EFI_VARIABLE_AUTHORITY, payload);
+					break;
+				}
+				case synthetic_event::efi_action:
+					set(next(2) ? 4 : 5, EV_EFI_ACTION, events::efi_action { std::string(pick(actions)) });
+					break;
+				case synthetic_event::ipl:
+				{
+					auto command = std::string(pick(commands)) + std::to_string(next(1000));
+
+					set(next(2) ? 8 : 9, EV_IPL, events::ipl { command });
+					break;
+				}
+				case synthetic_event::separator:
+					set(static_cast<uint32_t>(next(8)), EV_SEPARATOR, events::separator {});
+					break;
+				case synthetic_event::gpt:
+					set(5, EV_EFI_GPT_EVENT, random_bytes<events::raw_event_t>(92 + 8 + 128 * (1 + next(4))));
+					break;
+				}
+
+				return event;
+			}
+
+			events::uefi_blob_1 blob()
+			{
+				return {
+					.blob_base = 0xff000000 + next(0x100) * 0x10000,
+					.blob_length = 0x10000 * (1 + next(0x40)),
+				};
+			}
+
+			// PciRoot(0x0)/Pci(0x0,0x1d)/.../NVMe(0x1,...)/HD(1,GPT,...)/\EFI\...\*.EFI, shortened from the left
+			device_path_buffer make_device_path()
+			{
+				auto depth = m_options.device_path_depth;
+
+				m_nodes.clear();
+
+				if (depth >= 3)
+				{
+					m_nodes.push_back(device_path::acpi::acpi { .hid = 0x0a0341d0, .uid = 0 });
+				}
+
+				for (std::size_t i = 4; i < depth; i++)
+				{
+					m_nodes.push_back(device_path::hardware::pci {
+						.function = static_cast<uint8_t>(next(8)),
+						.device = static_cast<uint8_t>(next(32)),
+					});
+				}
+
+				if (depth >= 4)
+				{
+					device_path::messaging::nvme_namespace nvme { .namespace_identifier = 1 };
+
+					for (auto& byte : nvme.extended_unique_identifier)
+					{
+						byte = static_cast<uint8_t>(m_random());
+					}
+
+					m_nodes.push_back(nvme);
+				}
+
+				if (depth >= 2)
+				{
+					device_path::media::hard_drive partition {
+						.partition_number = static_cast<uint32_t>(1 + next(4)),
+						.partition_start = 2048,
+						.partition_size = m_random() & 0xffffff,
+						.partition_format = 2,
+						.signature_type = 2,
+					};
+
+					for (auto& byte : partition.signature)
+					{
+						byte = static_cast<uint8_t>(m_random());
+					}
+
+					m_nodes.push_back(partition);
+				}
+
+				if (depth >= 1)
+				{
+					auto path = "\\EFI\\" + std::string(pick(vendors)) + "\\" + std::string(pick(files));
+
+					m_nodes.push_back(device_path::media::file { .path = to_utf16(path) });
+				}
+
+				m_path.clear();
+
+				device_path::write(m_path, m_nodes);
+
+				return device_path_buffer(m_path);
+			}
+
+			template <typename T>
+			T image()
+			{
+				T event;
+
+				event.image_location_in_memory = 0x10000000 + next(0x1000) * 0x1000;
+				event.image_length_in_memory = 0x1000 * (1 + next(0x400));
+				event.image_link_time_address = 0;
+				event.device_path = make_device_path();
+
+				return event;
+			}
+
+			template <typename T>
+			T variable(const std::array<uint8_t, 16>& guid, std::string_view name, std::size_t max_data_size)
+			{
+				T event;
+
+				event.variable_name = guid;
+				event.unicode_name = to_utf16(name);
+				event.variable_data = random_bytes<std::vector<uint8_t>>(1 + next(max_data_size));
+
+				return event;
+			}
+
+			const log_generator_options& m_options;
+			std::mt19937_64 m_random;
+			uint64_t m_total_weight = 0;
+			std::vector<device_path_t> m_nodes;
+			std::vector<std::byte> m_path;
+		};
+	} // namespace details
+
+	struct synthetic_log
+	{
+		tcg_pgr_event_1 header;
+		std::vector<tcg_pgr_event_2> events;
+	};
+
+	// Makes up the events of a well-formed log with random digests and realistic payloads. The same options always
+	// produce the same events.
+	synthetic_log generate_events(const log_generator_options& options)
+	{
+		details::synthetic_event_source source(options);
+
+		synthetic_log log {
+			.header = source.spec_id_event(),
+		};
+
+		tcg_pgr_event_2 event;
+
+		for (std::size_t i = 0; i < options.event_count && source.next_event(event); i++)
+		{
+			log.events.push_back(std::move(event));
+		}
+
+		return log;
+	}
+
+	// Encodes the events generate_events would make up for the options, one event at a time
+	std::optional<std::vector<std::byte>> generate_log(const log_generator_options& options)
+	{
+		details::synthetic_event_source source(options);
+
+		std::vector<std::byte> output;
+
+		if (!write_event_1(output, source.spec_id_event()))
+		{
+			return {};
+		}
+
+		tcg_pgr_event_2 event;
+
+		for (std::size_t i = 0; i < options.event_count && source.next_event(event); i++)
+		{
+			if (!write_event_2(output, event))
+			{
+				return {};
+			}
+		}
+
+		return output;
+	}
+
+	// Corrupts a well-formed log the way a hostile one would be. One size field, the event size of an event, a length
+	// of a UEFI variable or the number of algorithms of the spec ID event, is set far beyond what the log holds, and a
+	// few other bytes are overwritten at random. The same log and seed always produce the same result.
+	std::vector<std::byte> generate_hostile_log(std::span<const std::byte> file, uint64_t seed)
+	{
+		std::mt19937_64 random(seed);
+		std::vector<std::byte> output(file.begin(), file.end());
+
+		// The offset and width of every size field, with the event data of the spec ID event after its header
+		constexpr auto spec_id_data = offsetof(tcg_pgr_event_1, event) + sizeof(uint32_t);
+
+		std::vector<std::pair<std::size_t, std::size_t>> fields = {
+			{ offsetof(tcg_pgr_event_1, event), sizeof(uint32_t) },
+			{ spec_id_data + offsetof(events::efi_spec_id, digest_sizes), sizeof(uint32_t) },
+		};
+
+		auto input = file;
+		auto header = read_event_1(input);
+		auto spec_event = header ? std::get_if<events::efi_spec_id>(&header->event) : nullptr;
+
+		if (!spec_event)
+		{
+			return output;
+		}
+
+		event_framer framer(spec_event->digest_sizes);
+
+		while (auto view = framer(input))
+		{
+			auto data = static_cast<std::size_t>(view->event.data() - file.data());
+
+			fields.emplace_back(data - sizeof(uint32_t), sizeof(uint32_t));
+
+			if (view->event_type == EV_EFI_VARIABLE_DRIVER_CONFIG || view->event_type == EV_EFI_VARIABLE_BOOT ||
+				view->event_type == EV_EFI_VARIABLE_AUTHORITY)
+			{
+				auto name_length = data + offsetof(events::efi_variable_boot, unicode_name);
+
+				fields.emplace_back(name_length, sizeof(uint64_t));
+				fields.emplace_back(name_length + sizeof(uint64_t), sizeof(uint64_t));
+			}
+		}
+
+		// All ones, a power of two that is at least half the field, or anything at all
+		auto [offset, width] = fields[random() % size(fields)];
+		auto bits = width * 8;
+
+		uint64_t value;
+
+		switch (random() % 3)
+		{
+		case 0:
+			value = ~uint64_t();
+			break;
+		case 1:
+			value = uint64_t(1) << (bits / 2 + random() % (bits / 2));
+			break;
+		default:
+			value = random();
+			break;
+		}
+
+		for (std::size_t i = 0; i < width; i++)
+		{
+			output[offset + i] = static_cast<std::byte>(value >> (i * 8));
+		}
+
+		for (auto count = random() % 4; count > 0; count--)
+		{
+			output[random() % size(output)] = static_cast<std::byte>(random());
+		}
+
+		return output;
+	}
+} // namespace tcg_parser
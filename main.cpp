@@ -1,7 +1,12 @@
-#include <fstream>
-#include <iomanip>
+#include <format>
 #include <iostream>
+#include <span>
 
+#include "digest_verifier.hpp"
+#include "hex.hpp"
+#include "json.hpp"
+#include "mapped_file.hpp"
+#include "pcr_replay.hpp"
 #include "tcg_parser.hpp"
 
 void handle_event(const tcg_parser::tcg_pgr_event_2& header, auto event)
@@ -16,16 +21,9 @@ void handle_event(const tcg_parser::tcg_pgr_event_2& header, const tcg_parser::e
 
 	std::cout << "\tDigests:" << std::endl;
 
-	for (auto& digest : header.digests)
+	for (auto digest : header.digests)
 	{
-		std::cout << "\t\t- ";
-
-		for (auto c : digest)
-		{
-			std::cout << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(static_cast<uint8_t>(c));
-		}
-
-		std::cout << std::endl;
+		std::cout << std::format("\t\t- {}", digest) << std::endl;
 	}
 
 	std::cout << "\tLocation in memory: 0x" << std::hex << event.image_location_in_memory << std::endl;
@@ -41,16 +39,9 @@ void handle_event(const tcg_parser::tcg_pgr_event_2& header, const tcg_parser::e
 
 	std::cout << "\tDigests:" << std::endl;
 
-	for (auto& digest : header.digests)
+	for (auto digest : header.digests)
 	{
-		std::cout << "\t\t- ";
-
-		for (auto c : digest)
-		{
-			std::cout << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(static_cast<uint8_t>(c));
-		}
-
-		std::cout << std::endl;
+		std::cout << std::format("\t\t- {}", digest) << std::endl;
 	}
 
 	std::cout << "\tLocation in memory: 0x" << std::hex << event.image_location_in_memory << std::endl;
@@ -66,16 +57,9 @@ void handle_event(const tcg_parser::tcg_pgr_event_2& header, const tcg_parser::e
 
 	std::cout << "\tDigests:" << std::endl;
 
-	for (auto& digest : header.digests)
+	for (auto digest : header.digests)
 	{
-		std::cout << "\t\t- ";
-
-		for (auto c : digest)
-		{
-			std::cout << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(static_cast<uint8_t>(c));
-		}
-
-		std::cout << std::endl;
+		std::cout << std::format("\t\t- {}", digest) << std::endl;
 	}
 
 	std::cout << "\tLocation in memory: 0x" << std::hex << event.image_location_in_memory << std::endl;
@@ -96,14 +80,7 @@ void handle_event(const tcg_parser::tcg_pgr_event_2& header, const tcg_parser::e
 	}
 
 	std::cout << std::endl;
-	std::cout << "\tData: ";
-
-	for (auto c : event.variable_data)
-	{
-		std::cout << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(c);
-	}
-
-	std::cout << std::endl;
+	std::cout << "\tData: " << tcg_parser::to_hex(std::as_bytes(std::span(event.variable_data))) << std::endl;
 }
 
 // void handle_event(const tcg_parser::tcg_pgr_event_2& header, const tcg_parser::events::efi_variable_driver_config& event)
@@ -241,11 +218,87 @@ void handle_event(const tcg_parser::tcg_pgr_event_2& header, const tcg_parser::e
 	std::cout << "SEPARATOR" << std::endl;
 }
 
-int main()
+int main(int argc, char** argv)
 {
-	std::ifstream stream("/home/znurre/boot.tcl", std::ios::binary | std::ios::in);
+	auto json = argc > 1 && argv[1] == "--json"sv;
+	auto pcrs = argc > 1 && argv[1] == "--pcrs"sv;
+	auto verify = argc > 1 && argv[1] == "--verify"sv;
+
+	if (json || pcrs || verify)
+	{
+		argc--;
+		argv++;
+	}
+
+	auto file = tcg_parser::mapped_file::open(argc > 1 ? argv[1] : "/sys/kernel/security/tpm0/binary_bios_measurements");
+
+	if (!file)
+	{
+		return 1;
+	}
+
+	auto input = file->data();
+
+	if (pcrs)
+	{
+		auto replay = tcg_parser::replay_log(input);
+
+		if (!replay)
+		{
+			return 1;
+		}
 
-	if (auto header = tcg_parser::read_event_1(stream))
+		for (auto hash_alg : replay->hash_algs())
+		{
+			std::cout << tcg_parser::hash_alg_name(hash_alg) << ":" << std::endl;
+
+			for (uint32_t pcr_index = 0; pcr_index < tcg_parser::pcr_count; pcr_index++)
+			{
+				std::cout << std::format("\t{:2}: {}", pcr_index, replay->value(hash_alg, pcr_index)) << std::endl;
+			}
+		}
+
+		return 0;
+	}
+
+	if (verify)
+	{
+		auto mismatches = tcg_parser::digest_verifier().verify(input);
+
+		if (!mismatches)
+		{
+			return 1;
+		}
+
+		for (auto& mismatch : *mismatches)
+		{
+			std::cout << std::format(
+				"Event {} at offset {:#x}, PCR {}, {}: ",
+				mismatch.index,
+				mismatch.offset,
+				mismatch.pcr_index,
+				tcg_parser::to_string(mismatch.event_type)
+			);
+
+			if (mismatch.computed.size() == 0)
+			{
+				std::cout << "the event data is cut short" << std::endl;
+			}
+			else
+			{
+				std::cout << std::format(
+					"{} digest {} but the event data hashes to {}",
+					tcg_parser::hash_alg_name(mismatch.recorded.hash_alg()),
+					mismatch.recorded,
+					mismatch.computed
+				) << std::endl;
+			}
+		}
+
+		return mismatches->empty() ? 0 : 1;
+	}
+
+	if (auto header = tcg_parser::read_event_1(input))
 	{
 		if (auto spec_event = std::get_if<tcg_parser::events::efi_spec_id>(&header->event))
 		{
@@ -254,13 +307,29 @@ int main()
 				return 1;
 			}
 
-			while (auto header = tcg_parser::read_event_2(stream, spec_event->digest_sizes))
+			if (json)
 			{
+				tcg_parser::buffered_writer writer(STDOUT_FILENO);
+				tcg_parser::json_serializer serializer(writer);
+
+				serializer(*header);
+
+				tcg_parser::visit_events_2(input, spec_event->digest_sizes, serializer);
+
+				return writer.flush() ? 0 : 1;
+			}
+
+			tcg_parser::event_framer framer(spec_event->digest_sizes);
+
+			while (auto view = framer(input))
+			{
+				auto header = tcg_parser::decode_event_2(*view, spec_event->digest_sizes);
+
 				std::visit(
-					[header](auto&& event) {
-						handle_event(*header, event);
+					[&header](auto&& event) {
+						handle_event(header, event);
 					},
-					header->event
+					header.event
 				);
 			}
 		}
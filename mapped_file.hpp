@@ -0,0 +1,172 @@
+#pragma once
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace tcg_parser
+{
+	namespace details
+	{
+		// Returns count elements of T at offset in a mapped file, if they lie within it and are aligned for T
+		template <typename T>
+		std::optional<std::span<const T>> file_section(
+			std::span<const std::byte> input,
+			uint64_t offset,
+			uint64_t count
+		)
+		{
+			if (offset % alignof(T) || offset > size(input) || count > (size(input) - offset) / sizeof(T))
+			{
+				return {};
+			}
+
+			return std::span(reinterpret_cast<const T*>(input.data() + offset), count);
+		}
+
+		// Appends a section for file_section, padded so that the next section starts at a multiple of 8 bytes
+		template <typename T>
+		void append_section(std::vector<std::byte>& output, std::span<const T> section)
+		{
+			auto bytes = std::as_bytes(section);
+
+			output.insert(end(output), bytes.begin(), bytes.end());
+			output.resize((size(output) + 7) & ~std::size_t(7));
+		}
+	} // namespace details
+
+	class mapped_file
+	{
+	public:
+		mapped_file(const mapped_file&) = delete;
+
+		mapped_file(mapped_file&& other) noexcept
+			: m_mapping(std::exchange(other.m_mapping, nullptr))
+			, m_size(std::exchange(other.m_size, 0))
+			, m_buffer(std::move(other.m_buffer))
+		{
+		}
+
+		~mapped_file()
+		{
+			if (m_mapping)
+			{
+				munmap(m_mapping, m_size);
+			}
+		}
+
+		mapped_file& operator=(const mapped_file&) = delete;
+
+		mapped_file& operator=(mapped_file&& other) noexcept
+		{
+			std::swap(m_mapping, other.m_mapping);
+			std::swap(m_size, other.m_size);
+			std::swap(m_buffer, other.m_buffer);
+
+			return *this;
+		}
+
+		std::span<const std::byte> data() const
+		{
+			if (m_mapping)
+			{
+				return { static_cast<const std::byte*>(m_mapping), m_size };
+			}
+
+			return m_buffer;
+		}
+
+		static std::optional<mapped_file> open(const char* path)
+		{
+			auto descriptor = ::open(path, O_RDONLY | O_CLOEXEC);
+
+			if (descriptor < 0)
+			{
+				return {};
+			}
+
+			auto file = map(descriptor);
+
+			if (!file)
+			{
+				file = read(descriptor);
+			}
+
+			::close(descriptor);
+
+			return file;
+		}
+
+	private:
+		mapped_file() = default;
+
+		static std::optional<mapped_file> map(int descriptor)
+		{
+			struct stat status;
+
+			// Files in securityfs and other pseudo file systems report a size of zero and cannot be mapped
+			if (fstat(descriptor, &status) != 0 || !S_ISREG(status.st_mode) || status.st_size <= 0)
+			{
+				return {};
+			}
+
+			auto mapping = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+
+			if (mapping == MAP_FAILED)
+			{
+				return {};
+			}
+
+			madvise(mapping, status.st_size, MADV_SEQUENTIAL);
+
+			mapped_file file;
+
+			file.m_mapping = mapping;
+			file.m_size = status.st_size;
+
+			return file;
+		}
+
+		static std::optional<mapped_file> read(int descriptor)
+		{
+			constexpr std::size_t chunk_size = 64 * 1024;
+
+			mapped_file file;
+
+			for (;;)
+			{
+				auto offset = size(file.m_buffer);
+
+				file.m_buffer.resize(offset + chunk_size);
+
+				auto result = ::read(descriptor, file.m_buffer.data() + offset, chunk_size);
+
+				if (result < 0 && errno != EINTR)
+				{
+					return {};
+				}
+
+				file.m_buffer.resize(offset + std::max<ssize_t>(result, 0));
+
+				if (result == 0)
+				{
+					return file;
+				}
+			}
+		}
+
+		void* m_mapping = nullptr;
+		std::size_t m_size = 0;
+		std::vector<std::byte> m_buffer;
+	};
+} // namespace tcg_parser
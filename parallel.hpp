@@ -0,0 +1,257 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "tcg_parser.hpp"
+
+namespace tcg_parser
+{
+	namespace details
+	{
+		// Runs batches of indexed work across a fixed set of threads. Every thread owns a queue of index ranges,
+		// takes work from the front of its own queue and steals from the back of the others once it runs dry.
+		class work_stealing_pool
+		{
+		public:
+			explicit work_stealing_pool(unsigned thread_count)
+				: m_queues(std::max(thread_count, 1u))
+			{
+				for (std::size_t i = 1; i < size(m_queues); i++)
+				{
+					m_threads.emplace_back([this, i](std::stop_token token) {
+						run(token, i);
+					});
+				}
+			}
+
+			~work_stealing_pool()
+			{
+				for (auto& thread : m_threads)
+				{
+					thread.request_stop();
+				}
+
+				{
+					std::lock_guard lock(m_mutex);
+
+					m_wake.notify_all();
+				}
+
+				m_threads.clear();
+			}
+
+			std::size_t thread_count() const
+			{
+				return size(m_queues);
+			}
+
+			// Calls function(i) for every i in [0, count) and returns once all calls have completed.
+			// The calling thread takes part in the work.
+			void for_each_index(
+				std::size_t count,
+				std::size_t chunk_size,
+				const std::function<void(std::size_t)>& function
+			)
+			{
+				if (!count)
+				{
+					return;
+				}
+
+				std::lock_guard submit(m_submit);
+
+				m_function = &function;
+				m_remaining = count;
+
+				for (std::size_t begin = 0, chunk = 0; begin < count; begin += chunk_size, chunk++)
+				{
+					auto& queue = m_queues[chunk % size(m_queues)];
+
+					std::lock_guard lock(queue.mutex);
+
+					queue.ranges.emplace_back(begin, std::min(begin + chunk_size, count));
+				}
+
+				{
+					std::lock_guard lock(m_mutex);
+
+					m_generation++;
+					m_wake.notify_all();
+				}
+
+				drain(0);
+
+				std::unique_lock lock(m_mutex);
+
+				m_done.wait(lock, [this] {
+					return m_remaining == 0;
+				});
+			}
+
+		private:
+			using range = std::pair<std::size_t, std::size_t>;
+
+			struct queue
+			{
+				std::mutex mutex;
+				std::deque<range> ranges;
+			};
+
+			std::optional<range> take(std::size_t thread)
+			{
+				for (std::size_t i = 0; i < size(m_queues); i++)
+				{
+					auto& queue = m_queues[(thread + i) % size(m_queues)];
+
+					std::lock_guard lock(queue.mutex);
+
+					if (queue.ranges.empty())
+					{
+						continue;
+					}
+
+					if (i == 0)
+					{
+						auto result = queue.ranges.front();
+
+						queue.ranges.pop_front();
+
+						return result;
+					}
+
+					auto result = queue.ranges.back();
+
+					queue.ranges.pop_back();
+
+					return result;
+				}
+
+				return {};
+			}
+
+			void drain(std::size_t thread)
+			{
+				while (auto work = take(thread))
+				{
+					auto [begin, end] = *work;
+
+					for (auto i = begin; i < end; i++)
+					{
+						(*m_function)(i);
+					}
+
+					if (m_remaining.fetch_sub(end - begin) == end - begin)
+					{
+						std::lock_guard lock(m_mutex);
+
+						m_done.notify_all();
+					}
+				}
+			}
+
+			void run(std::stop_token token, std::size_t thread)
+			{
+				auto generation = 0ull;
+
+				while (true)
+				{
+					{
+						std::unique_lock lock(m_mutex);
+
+						m_wake.wait(lock, [&] {
+							return token.stop_requested() || m_generation != generation;
+						});
+
+						if (token.stop_requested())
+						{
+							return;
+						}
+
+						generation = m_generation;
+					}
+
+					drain(thread);
+				}
+			}
+
+			std::vector<queue> m_queues;
+			std::vector<std::jthread> m_threads;
+
+			std::mutex m_submit;
+			std::mutex m_mutex;
+			std::condition_variable m_wake;
+			std::condition_variable m_done;
+			unsigned long long m_generation = 0;
+
+			const std::function<void(std::size_t)>* m_function = nullptr;
+			std::atomic<std::size_t> m_remaining = 0;
+		};
+	} // namespace details
+
+	// Frames events sequentially, then decodes their payloads across a pool of threads.
+	// Events are returned in log order.
+	class parallel_reader
+	{
+	public:
+		explicit parallel_reader(unsigned thread_count = std::thread::hardware_concurrency())
+			: m_pool(thread_count)
+		{
+		}
+
+		std::vector<tcg_pgr_event_2> read_events_2(
+			std::span<const std::byte>& input,
+			const std::vector<events::efi_spec_id::digest_size>& digest_sizes
+		)
+		{
+			parse_budget budget;
+
+			return read_events_2(input, digest_sizes, budget);
+		}
+
+		// Stops before the first event that does not fit in the budget, as it does before one that is malformed
+		std::vector<tcg_pgr_event_2> read_events_2(
+			std::span<const std::byte>& input,
+			const std::vector<events::efi_spec_id::digest_size>& digest_sizes,
+			parse_budget& budget
+		)
+		{
+			event_framer framer(digest_sizes);
+
+			std::vector<tcg_pgr_event_2_view> views;
+
+			for (auto remaining = input; auto view = framer(remaining); input = remaining)
+			{
+				if (!budget.take(size(view->event)))
+				{
+					break;
+				}
+
+				views.push_back(*view);
+			}
+
+			std::vector<tcg_pgr_event_2> events(size(views));
+
+			m_pool.for_each_index(size(views), chunk_size, [&](std::size_t i) {
+				events[i] = decode_event_2(views[i], digest_sizes, budget.limits());
+			});
+
+			return events;
+		}
+
+	private:
+		static constexpr std::size_t chunk_size = 16;
+
+		details::work_stealing_pool m_pool;
+	};
+} // namespace tcg_parser
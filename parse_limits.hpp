@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <limits>
+
+namespace tcg_parser
+{
+	// Limits on what parsing a log may allocate. Sizes in a log are checked against the input that is left before
+	// anything is allocated for them, and against these limits, so that a hostile log cannot ask for more memory than
+	// it holds, nor for more than a verifier is willing to spend on it.
+	struct parse_limits
+	{
+		// Largest event data of a single event, in bytes
+		std::size_t max_event_size = 16 * 1024 * 1024;
+		// Longest UEFI variable name, in characters
+		std::size_t max_variable_name_length = 64 * 1024;
+		// Largest UEFI variable data, in bytes
+		std::size_t max_variable_data_length = 16 * 1024 * 1024;
+		// Most hash algorithms a spec ID event may list, which push_parser also takes as the most digests of an event
+		std::size_t max_algorithms = 256;
+		// Most event data all the events of one log may decode, in bytes. The payload decoded from an event never
+		// takes much more memory than its event data.
+		std::size_t memory_budget = 256 * 1024 * 1024;
+
+		// No limits beyond the size of the input
+		static constexpr parse_limits unlimited()
+		{
+			constexpr auto max = std::numeric_limits<std::size_t>::max();
+
+			return {
+				.max_event_size = max,
+				.max_variable_name_length = max,
+				.max_variable_data_length = max,
+				.max_algorithms = max,
+				.memory_budget = max,
+			};
+		}
+	};
+
+	// Keeps count of the memory budget of one log across the events read from it
+	class parse_budget
+	{
+	public:
+		explicit parse_budget(const parse_limits& limits = {})
+			: m_limits(limits)
+		{
+		}
+
+		const parse_limits& limits() const
+		{
+			return m_limits;
+		}
+
+		// Takes the event data of one event from the budget. Fails, leaving the budget as it was, if the event is
+		// larger than max_event_size or than what is left.
+		bool take(std::size_t event_size)
+		{
+			if (event_size > m_limits.max_event_size || event_size > m_limits.memory_budget - m_used)
+			{
+				return false;
+			}
+
+			m_used += event_size;
+
+			return true;
+		}
+
+		std::size_t used() const
+		{
+			return m_used;
+		}
+
+	private:
+		parse_limits m_limits;
+		std::size_t m_used = 0;
+	};
+} // namespace tcg_parser
@@ -0,0 +1,253 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+#include "sha.hpp"
+#include "tcg_parser.hpp"
+
+namespace tcg_parser
+{
+	// The PCRs of a PC Client TPM
+	constexpr std::size_t pcr_count = 24;
+
+	namespace details
+	{
+		constexpr auto startup_locality_signature = "StartupLocality\0"sv;
+
+		// Returns the locality of a StartupLocality event, which has the signature followed by a single byte
+		std::optional<uint8_t> startup_locality(
+			uint32_t pcr_index,
+			uint32_t event_type,
+			std::span<const std::byte> data
+		)
+		{
+			auto signature = std::as_bytes(std::span(startup_locality_signature));
+
+			if (pcr_index != 0 || event_type != EV_NO_ACTION || size(data) <= size(signature))
+			{
+				return {};
+			}
+
+			if (!std::ranges::equal(data.first(size(signature)), signature))
+			{
+				return {};
+			}
+
+			return std::to_integer<uint8_t>(data[size(signature)]);
+		}
+	} // namespace details
+
+	// Replays the digests of a log into the PCR values they extend to, PCR = H(PCR || digest), with one bank of PCRs
+	// for each algorithm of the spec ID event that hash can compute. PCRs 17 to 22 start out as all ones, as they do
+	// until a dynamic launch resets them, and all others as zeros.
+	class pcr_replay
+	{
+	public:
+		explicit pcr_replay(const std::vector<events::efi_spec_id::digest_size>& digest_sizes)
+			: m_digest_sizes(digest_sizes)
+		{
+			for (auto entry : digest_sizes)
+			{
+				if (!can_hash(entry.hash_alg) || entry.digest_size != digest_size(entry.hash_alg))
+				{
+					continue;
+				}
+
+				bank bank { .hash_alg = entry.hash_alg, .digest_size = entry.digest_size };
+
+				for (std::size_t pcr_index = 0; pcr_index < pcr_count; pcr_index++)
+				{
+					auto value = pcr_index >= 17 && pcr_index <= 22 ? std::byte(0xff) : std::byte(0);
+
+					bank.pcrs[pcr_index].fill(value);
+				}
+
+				m_banks.push_back(bank);
+			}
+		}
+
+		// Extends the PCR of an event with each of its digests. EV_NO_ACTION events are not extended, but a
+		// StartupLocality event ahead of the first extend of PCR 0 sets the locality as the last byte of its value.
+		// Fails if the PCR index is out of range.
+		bool extend(const tcg_pgr_event_2& event)
+		{
+			std::span<const std::byte> data;
+
+			if (auto raw = std::get_if<events::raw_event_t>(&event.event))
+			{
+				data = std::as_bytes(std::span(*raw));
+			}
+
+			return extend(event.pcr_index, event.event_type, data, [&](auto&& function) {
+				for (auto digest : event.digests)
+				{
+					function(digest.hash_alg(), digest.bytes());
+				}
+			});
+		}
+
+		bool extend(const tcg_pgr_event_2_view& view)
+		{
+			return extend(view.pcr_index, view.event_type, view.event, [&](auto&& function) {
+				details::for_each_digest(view, m_digest_sizes, function);
+			});
+		}
+
+		// Same as above, but only extends the banks of the algorithms given. A StartupLocality event still sets PCR 0
+		// of every bank.
+		bool extend(const tcg_pgr_event_2_view& view, std::span<const uint16_t> hash_algs)
+		{
+			return extend(view.pcr_index, view.event_type, view.event, [&](auto&& function) {
+				details::for_each_digest(view, m_digest_sizes, [&](uint16_t entry, std::span<const std::byte> digest) {
+					if (std::ranges::find(hash_algs, entry) != end(hash_algs))
+					{
+						function(entry, digest);
+					}
+				});
+			});
+		}
+
+		bool extend(const tcg_pgr_event_2_view& view, uint16_t hash_alg)
+		{
+			return extend(view, std::span(&hash_alg, 1));
+		}
+
+		// The algorithms of the banks that are replayed
+		std::vector<uint16_t> hash_algs() const
+		{
+			std::vector<uint16_t> hash_algs;
+
+			for (auto& bank : m_banks)
+			{
+				hash_algs.push_back(bank.hash_alg);
+			}
+
+			return hash_algs;
+		}
+
+		// Returns an empty digest if the algorithm is not replayed or the PCR index is out of range
+		digest value(uint16_t hash_alg, uint32_t pcr_index) const
+		{
+			auto entry = std::ranges::find(m_banks, hash_alg, &bank::hash_alg);
+
+			if (entry == end(m_banks) || pcr_index >= pcr_count)
+			{
+				return {};
+			}
+
+			return digest(hash_alg, std::span(entry->pcrs[pcr_index]).first(entry->digest_size));
+		}
+
+		// Overwrites the value of a PCR, for banks that are replayed elsewhere. Fails if the algorithm is not replayed,
+		// the PCR index is out of range or the value has the wrong size.
+		bool set_value(uint16_t hash_alg, uint32_t pcr_index, std::span<const std::byte> value)
+		{
+			auto entry = std::ranges::find(m_banks, hash_alg, &bank::hash_alg);
+
+			if (entry == end(m_banks) || pcr_index >= pcr_count || size(value) != entry->digest_size)
+			{
+				return false;
+			}
+
+			std::ranges::copy(value, entry->pcrs[pcr_index].begin());
+
+			return true;
+		}
+
+	private:
+		struct bank
+		{
+			uint16_t hash_alg;
+			uint16_t digest_size;
+			std::array<std::array<std::byte, digest::max_size>, pcr_count> pcrs;
+		};
+
+		bool extend(uint32_t pcr_index, uint32_t event_type, std::span<const std::byte> data, auto&& for_each_digest)
+		{
+			if (pcr_index >= pcr_count)
+			{
+				return false;
+			}
+
+			if (event_type == EV_NO_ACTION)
+			{
+				auto locality = details::startup_locality(pcr_index, event_type, data);
+
+				if (locality && !m_pcr0_extended)
+				{
+					for (auto& bank : m_banks)
+					{
+						bank.pcrs[0].fill(std::byte(0));
+						bank.pcrs[0][bank.digest_size - 1] = std::byte(*locality);
+					}
+				}
+
+				return true;
+			}
+
+			m_pcr0_extended |= pcr_index == 0;
+
+			for_each_digest([&](uint16_t hash_alg, std::span<const std::byte> event_digest) {
+				auto entry = std::ranges::find(m_banks, hash_alg, &bank::hash_alg);
+
+				if (entry == end(m_banks) || size(event_digest) != entry->digest_size)
+				{
+					return;
+				}
+
+				auto& pcr = entry->pcrs[pcr_index];
+				std::array<std::byte, digest::max_size * 2> message;
+
+				std::memcpy(message.data(), pcr.data(), entry->digest_size);
+				std::memcpy(message.data() + entry->digest_size, event_digest.data(), entry->digest_size);
+
+				auto value = hash(hash_alg, std::span(message).first(entry->digest_size * 2));
+
+				std::memcpy(pcr.data(), value.data(), entry->digest_size);
+			});
+
+			return true;
+		}
+
+		std::vector<events::efi_spec_id::digest_size> m_digest_sizes;
+		std::vector<bank> m_banks;
+		bool m_pcr0_extended = false;
+	};
+
+	// Replays every event of a log. Fails if the log does not start with a spec ID event.
+	std::optional<pcr_replay> replay_log(std::span<const std::byte> input)
+	{
+		auto header = read_event_1(input);
+
+		if (!header)
+		{
+			return {};
+		}
+
+		auto spec_event = std::get_if<events::efi_spec_id>(&header->event);
+
+		if (!spec_event)
+		{
+			return {};
+		}
+
+		pcr_replay replay(spec_event->digest_sizes);
+		event_framer framer(spec_event->digest_sizes);
+
+		while (auto view = framer(input))
+		{
+			replay.extend(*view);
+		}
+
+		return replay;
+	}
+} // namespace tcg_parser
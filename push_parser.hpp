@@ -0,0 +1,253 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "parse_limits.hpp"
+#include "tcg_parser.hpp"
+
+namespace tcg_parser
+{
+	// Parses a log that arrives in arbitrary chunks, such as from a pipe or a socket.
+	// Events are handed out as soon as their last byte has been fed. Only the incomplete event at the end of
+	// a chunk is copied, and the parser never needs to go back in the input.
+	class push_parser
+	{
+	public:
+		// Limits the event data of each event and nothing else
+		explicit push_parser(std::size_t max_event_size = 16 * 1024 * 1024)
+			: push_parser(event_size_limits(max_event_size))
+		{
+		}
+
+		// The limits apply to the whole log fed to the parser, which is rejected once an event goes over them
+		explicit push_parser(const parse_limits& limits)
+			: m_budget(limits)
+		{
+		}
+
+		// The framer refers to the digest sizes held by the parser
+		push_parser(const push_parser&) = delete;
+
+		push_parser& operator=(const push_parser&) = delete;
+
+		// Calls handler with the tcg_pgr_event_1 that starts the log, and then with every tcg_pgr_event_2.
+		// Returns false once the log turns out to be malformed, after which all further input is rejected.
+		bool feed(std::span<const std::byte> chunk, auto&& handler)
+		{
+			while (m_good && !m_carry.empty())
+			{
+				auto required = required_size(m_carry);
+
+				if (!required)
+				{
+					return m_good = false;
+				}
+
+				if (size(m_carry) < *required)
+				{
+					if (chunk.empty())
+					{
+						return true;
+					}
+
+					auto count = std::min(*required - size(m_carry), size(chunk));
+
+					m_carry.insert(end(m_carry), chunk.begin(), chunk.begin() + count);
+
+					chunk = chunk.subspan(count);
+
+					continue;
+				}
+
+				if (std::span<const std::byte> input = m_carry; !read(input, handler) || !input.empty())
+				{
+					return m_good = false;
+				}
+
+				m_carry.clear();
+			}
+
+			while (m_good && !chunk.empty())
+			{
+				auto required = required_size(chunk);
+
+				if (!required)
+				{
+					return m_good = false;
+				}
+
+				if (size(chunk) < *required)
+				{
+					m_carry.assign(chunk.begin(), chunk.end());
+
+					return true;
+				}
+
+				if (!read(chunk, handler))
+				{
+					return m_good = false;
+				}
+			}
+
+			return m_good;
+		}
+
+		// Whether an incomplete event is still waiting for more input
+		bool pending() const
+		{
+			return !m_carry.empty();
+		}
+
+		bool good() const
+		{
+			return m_good;
+		}
+
+	private:
+		static constexpr std::size_t event_1_header_size = offsetof(tcg_pgr_event_1, event) + sizeof(uint32_t);
+		static constexpr std::size_t event_2_header_size = details::event_2_header_size;
+
+		static parse_limits event_size_limits(std::size_t max_event_size)
+		{
+			auto limits = parse_limits::unlimited();
+
+			limits.max_event_size = max_event_size;
+
+			return limits;
+		}
+
+		// Returns how many bytes the next event needs as far as can be told from the bytes available so far.
+		// Once that many bytes are available, it returns the full size of the event. Fails if the event is malformed
+		// or its event data is larger than max_event_size.
+		std::optional<std::size_t> required_size(std::span<const std::byte> input) const
+		{
+			auto load = [&](auto& value, std::size_t offset) {
+				std::memcpy(&value, input.data() + offset, sizeof(value));
+			};
+
+			if (!m_spec_event)
+			{
+				if (size(input) < event_1_header_size)
+				{
+					return event_1_header_size;
+				}
+
+				uint32_t event_size;
+
+				load(event_size, event_1_header_size - sizeof(event_size));
+
+				if (event_size > m_budget.limits().max_event_size)
+				{
+					return {};
+				}
+
+				return event_1_header_size + event_size;
+			}
+
+			if (size(input) < event_2_header_size)
+			{
+				return event_2_header_size;
+			}
+
+			uint32_t digest_count;
+
+			load(digest_count, 2 * sizeof(uint32_t));
+
+			if (digest_count > m_budget.limits().max_algorithms)
+			{
+				return {};
+			}
+
+			std::size_t offset = event_2_header_size;
+
+			for (auto i = 0u; i < digest_count; i++)
+			{
+				uint16_t hash_alg;
+
+				if (size(input) < offset + sizeof(hash_alg))
+				{
+					return offset + sizeof(hash_alg);
+				}
+
+				load(hash_alg, offset);
+
+				auto entry = std::ranges::find_if(m_spec_event->digest_sizes, [hash_alg](auto entry) {
+					return entry.hash_alg == hash_alg;
+				});
+
+				if (entry == end(m_spec_event->digest_sizes))
+				{
+					return {};
+				}
+
+				offset += sizeof(hash_alg) + entry->digest_size;
+			}
+
+			uint32_t event_size;
+
+			if (size(input) < offset + sizeof(event_size))
+			{
+				return offset + sizeof(event_size);
+			}
+
+			load(event_size, offset);
+
+			if (event_size > m_budget.limits().max_event_size)
+			{
+				return {};
+			}
+
+			return offset + sizeof(event_size) + event_size;
+		}
+
+		bool read(std::span<const std::byte>& input, auto& handler)
+		{
+			if (m_framer)
+			{
+				auto view = (*m_framer)(input);
+
+				if (!view || !m_budget.take(size(view->event)))
+				{
+					return false;
+				}
+
+				handler(decode_event_2(*view, m_spec_event->digest_sizes, m_budget.limits()));
+
+				return true;
+			}
+
+			auto header = read_event_1(input, m_budget);
+
+			if (!header)
+			{
+				return false;
+			}
+
+			auto spec_event = std::get_if<events::efi_spec_id>(&header->event);
+
+			if (!spec_event)
+			{
+				return false;
+			}
+
+			m_spec_event = *spec_event;
+			m_framer.emplace(m_spec_event->digest_sizes);
+
+			handler(*header);
+
+			return true;
+		}
+
+		parse_budget m_budget;
+		std::vector<std::byte> m_carry;
+		std::optional<events::efi_spec_id> m_spec_event;
+		std::optional<event_framer> m_framer;
+		bool m_good = true;
+	};
+} // namespace tcg_parser
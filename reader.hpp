@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <istream>
+#include <span>
+
+namespace tcg_parser
+{
+	namespace details
+	{
+		class stream_reader
+		{
+		public:
+			stream_reader(std::istream& stream)
+				: m_stream(stream)
+			{
+			}
+
+			bool read(void* target, std::size_t size)
+			{
+				return m_stream.read(static_cast<char*>(target), size).good();
+			}
+
+			bool skip(std::size_t size)
+			{
+				return m_stream.ignore(size).good();
+			}
+
+			bool good() const
+			{
+				return m_stream.good();
+			}
+
+		private:
+			std::istream& m_stream;
+		};
+
+		class span_reader
+		{
+		public:
+			span_reader(std::span<const std::byte> input)
+				: m_input(input)
+			{
+			}
+
+			bool read(void* target, std::size_t size)
+			{
+				if (auto bytes = take(size); !bytes.empty())
+				{
+					std::memcpy(target, bytes.data(), size);
+				}
+
+				return m_good;
+			}
+
+			bool skip(std::size_t size)
+			{
+				take(size);
+
+				return m_good;
+			}
+
+			std::span<const std::byte> take(std::size_t size)
+			{
+				if (!m_good || size > m_input.size())
+				{
+					m_good = false;
+					m_input = {};
+
+					return {};
+				}
+
+				auto bytes = m_input.first(size);
+
+				m_input = m_input.subspan(size);
+
+				return bytes;
+			}
+
+			bool good() const
+			{
+				return m_good;
+			}
+
+			std::span<const std::byte> remaining() const
+			{
+				return m_input;
+			}
+
+		private:
+			std::span<const std::byte> m_input;
+			bool m_good = true;
+		};
+	} // namespace details
+} // namespace tcg_parser
@@ -0,0 +1,216 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <variant>
+#include <vector>
+
+#include "pcr_replay.hpp"
+#include "tcg_parser.hpp"
+
+namespace tcg_parser
+{
+	// Replays a log once and keeps a copy of the PCRs every interval events, so that the PCRs after any event are a
+	// copy plus fewer than interval extends away. Refers into the input, which must outlive it.
+	class replay_checkpoints
+	{
+	public:
+		static std::optional<replay_checkpoints> build(std::span<const std::byte> input, std::size_t interval = 256)
+		{
+			if (interval == 0)
+			{
+				return {};
+			}
+
+			auto header = read_event_1(input);
+
+			if (!header)
+			{
+				return {};
+			}
+
+			auto spec_event = std::get_if<events::efi_spec_id>(&header->event);
+
+			if (!spec_event)
+			{
+				return {};
+			}
+
+			replay_checkpoints checkpoints(interval);
+
+			pcr_replay replay(spec_event->digest_sizes);
+			event_framer framer(spec_event->digest_sizes);
+
+			checkpoints.m_checkpoints.push_back(replay);
+
+			while (auto view = framer(input))
+			{
+				if (std::size(checkpoints.m_events) % interval == 0)
+				{
+					checkpoints.m_pcr_events.emplace_back();
+				}
+
+				checkpoints.m_events.push_back(*view);
+
+				if (view->pcr_index < pcr_count)
+				{
+					checkpoints.m_pcr_events.back()[view->pcr_index]++;
+				}
+
+				replay.extend(*view);
+
+				if (std::size(checkpoints.m_events) % interval == 0)
+				{
+					checkpoints.m_checkpoints.push_back(replay);
+				}
+			}
+
+			if (std::size(checkpoints.m_events) % interval != 0)
+			{
+				checkpoints.m_checkpoints.push_back(replay);
+			}
+
+			return checkpoints;
+		}
+
+		// The number of events after the spec ID event
+		std::size_t size() const
+		{
+			return std::size(m_events);
+		}
+
+		std::size_t interval() const
+		{
+			return m_interval;
+		}
+
+		// The PCRs after the first count events, where count is at most size()
+		pcr_replay pcrs_after(std::size_t count) const
+		{
+			auto checkpoint = count / m_interval;
+			auto replay = m_checkpoints[checkpoint];
+
+			for (auto event = checkpoint * m_interval; event < count; event++)
+			{
+				replay.extend(m_events[event]);
+			}
+
+			return replay;
+		}
+
+		// The value of a PCR after the first count events. Only the events of that PCR since the checkpoint before are
+		// hashed again, and only for the one bank.
+		digest value_after(uint16_t hash_alg, uint32_t pcr_index, std::size_t count) const
+		{
+			auto checkpoint = count / m_interval;
+
+			if (pcr_index >= pcr_count || m_checkpoints[checkpoint].value(hash_alg, pcr_index).size() == 0)
+			{
+				return {};
+			}
+
+			if (checkpoint < std::size(m_pcr_events) && m_pcr_events[checkpoint][pcr_index] == 0)
+			{
+				return m_checkpoints[checkpoint].value(hash_alg, pcr_index);
+			}
+
+			auto replay = m_checkpoints[checkpoint];
+
+			for (auto event = checkpoint * m_interval; event < count; event++)
+			{
+				if (m_events[event].pcr_index == pcr_index)
+				{
+					replay.extend(m_events[event], hash_alg);
+				}
+			}
+
+			return replay.value(hash_alg, pcr_index);
+		}
+
+		// Finds the smallest count of events after which a PCR has the expected value, for example to tell how far into
+		// the log a quote was taken. Zero means the PCR still had its initial value. The values of a PCR follow no
+		// order that a binary search could use, so the checkpoints narrow the search down instead: only intervals that
+		// end on the expected value or extend the PCR more than once are hashed again, for that PCR and bank alone.
+		std::optional<std::size_t> find_value(
+			uint16_t hash_alg,
+			uint32_t pcr_index,
+			std::span<const std::byte> expected
+		) const
+		{
+			if (pcr_index >= pcr_count || empty(expected))
+			{
+				return {};
+			}
+
+			auto matches = [&](const pcr_replay& replay) {
+				return std::ranges::equal(replay.value(hash_alg, pcr_index).bytes(), expected);
+			};
+
+			if (matches(m_checkpoints[0]))
+			{
+				return 0;
+			}
+
+			for (std::size_t checkpoint = 0; checkpoint < std::size(m_pcr_events); checkpoint++)
+			{
+				auto events = m_pcr_events[checkpoint][pcr_index];
+				auto end_matches = matches(m_checkpoints[checkpoint + 1]);
+
+				if (events == 0 || (events == 1 && !end_matches))
+				{
+					continue;
+				}
+
+				auto first = checkpoint * m_interval;
+				auto last = std::min(first + m_interval, size());
+
+				// With a single event of the PCR in the interval, that event must be the one that changed it
+				if (events == 1)
+				{
+					auto begin = m_events.begin();
+					auto event = std::find_if(begin + first, begin + last, [&](auto& view) {
+						return view.pcr_index == pcr_index;
+					});
+
+					return event - begin + 1;
+				}
+
+				auto replay = m_checkpoints[checkpoint];
+
+				for (auto event = first; event < last; event++)
+				{
+					if (m_events[event].pcr_index != pcr_index)
+					{
+						continue;
+					}
+
+					replay.extend(m_events[event], hash_alg);
+
+					if (matches(replay))
+					{
+						return event + 1;
+					}
+				}
+			}
+
+			return {};
+		}
+
+	private:
+		explicit replay_checkpoints(std::size_t interval)
+			: m_interval(interval)
+		{
+		}
+
+		std::size_t m_interval;
+		std::vector<tcg_pgr_event_2_view> m_events;
+		// The PCRs after every interval events, and after the last event
+		std::vector<pcr_replay> m_checkpoints;
+		// How many events of each PCR there are between one checkpoint and the next
+		std::vector<std::array<uint32_t, pcr_count>> m_pcr_events;
+	};
+} // namespace tcg_parser
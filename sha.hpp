@@ -0,0 +1,520 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#include "digest_bank.hpp"
+#include "hash_algorithms.hpp"
+
+namespace tcg_parser
+{
+	namespace details
+	{
+		template <typename Word>
+		Word load_be(const std::byte* input)
+		{
+			Word value;
+
+			std::memcpy(&value, input, sizeof(value));
+
+			if constexpr (sizeof(Word) == 8)
+			{
+				return __builtin_bswap64(value);
+			}
+			else
+			{
+				return __builtin_bswap32(value);
+			}
+		}
+
+		void store_be(std::byte* output, uint32_t value)
+		{
+			value = __builtin_bswap32(value);
+
+			std::memcpy(output, &value, sizeof(value));
+		}
+
+		void store_be(std::byte* output, uint64_t value)
+		{
+			value = __builtin_bswap64(value);
+
+			std::memcpy(output, &value, sizeof(value));
+		}
+
+		constexpr std::array<uint32_t, 5> sha1_initial = {
+			0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0,
+		};
+
+		constexpr std::array<uint32_t, 8> sha256_initial = {
+			0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+		};
+
+		constexpr std::array<uint64_t, 8> sha384_initial = {
+			0xcbbb9d5dc1059ed8, 0x629a292a367cd507, 0x9159015a3070dd17, 0x152fecd8f70e5939,
+			0x67332667ffc00b31, 0x8eb44a8768581511, 0xdb0c2e0d64f98fa7, 0x47b5481dbefa4fa4,
+		};
+
+		constexpr std::array<uint64_t, 8> sha512_initial = {
+			0x6a09e667f3bcc908, 0xbb67ae8584caa73b, 0x3c6ef372fe94f82b, 0xa54ff53a5f1d36f1,
+			0x510e527fade682d1, 0x9b05688c2b3e6c1f, 0x1f83d9abfb41bd6b, 0x5be0cd19137e2179,
+		};
+
+		alignas(16) constexpr std::array<uint32_t, 64> sha256_constants = {
+			0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+			0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+			0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+			0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+			0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+			0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+			0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+			0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+		};
+
+		alignas(16) constexpr std::array<uint64_t, 80> sha512_constants = {
+			0x428a2f98d728ae22, 0x7137449123ef65cd, 0xb5c0fbcfec4d3b2f, 0xe9b5dba58189dbbc, 0x3956c25bf348b538,
+			0x59f111f1b605d019, 0x923f82a4af194f9b, 0xab1c5ed5da6d8118, 0xd807aa98a3030242, 0x12835b0145706fbe,
+			0x243185be4ee4b28c, 0x550c7dc3d5ffb4e2, 0x72be5d74f27b896f, 0x80deb1fe3b1696b1, 0x9bdc06a725c71235,
+			0xc19bf174cf692694, 0xe49b69c19ef14ad2, 0xefbe4786384f25e3, 0x0fc19dc68b8cd5b5, 0x240ca1cc77ac9c65,
+			0x2de92c6f592b0275, 0x4a7484aa6ea6e483, 0x5cb0a9dcbd41fbd4, 0x76f988da831153b5, 0x983e5152ee66dfab,
+			0xa831c66d2db43210, 0xb00327c898fb213f, 0xbf597fc7beef0ee4, 0xc6e00bf33da88fc2, 0xd5a79147930aa725,
+			0x06ca6351e003826f, 0x142929670a0e6e70, 0x27b70a8546d22ffc, 0x2e1b21385c26c926, 0x4d2c6dfc5ac42aed,
+			0x53380d139d95b3df, 0x650a73548baf63de, 0x766a0abb3c77b2a8, 0x81c2c92e47edaee6, 0x92722c851482353b,
+			0xa2bfe8a14cf10364, 0xa81a664bbc423001, 0xc24b8b70d0f89791, 0xc76c51a30654be30, 0xd192e819d6ef5218,
+			0xd69906245565a910, 0xf40e35855771202a, 0x106aa07032bbd1b8, 0x19a4c116b8d2d0c8, 0x1e376c085141ab53,
+			0x2748774cdf8eeb99, 0x34b0bcb5e19b48a8, 0x391c0cb3c5c95a63, 0x4ed8aa4ae3418acb, 0x5b9cca4f7763e373,
+			0x682e6ff3d6b2b8a3, 0x748f82ee5defb2fc, 0x78a5636f43172f60, 0x84c87814a1f0ab72, 0x8cc702081a6439ec,
+			0x90befffa23631e28, 0xa4506cebde82bde9, 0xbef9a3f7b2c67915, 0xc67178f2e372532b, 0xca273eceea26619c,
+			0xd186b8c721c0c207, 0xeada7dd6cde0eb1e, 0xf57d4f7fee6ed178, 0x06f067aa72176fba, 0x0a637dc5a2c898a6,
+			0x113f9804bef90dae, 0x1b710b35131c471b, 0x28db77f523047d84, 0x32caab7b40c72493, 0x3c9ebe0a15c9bebc,
+			0x431d67c49c100d4c, 0x4cc5d4becb3e42b6, 0x597f299cfc657e2a, 0x5fcb6fab3ad6faec, 0x6c44198c4a475817,
+		};
+
+		void sha1_blocks_scalar(uint32_t* state, const std::byte* blocks, std::size_t count)
+		{
+			for (; count; count--, blocks += 64)
+			{
+				std::array<uint32_t, 80> w;
+
+				for (std::size_t t = 0; t < 16; t++)
+				{
+					w[t] = load_be<uint32_t>(blocks + t * 4);
+				}
+
+				for (std::size_t t = 16; t < 80; t++)
+				{
+					w[t] = std::rotl(w[t - 3] ^ w[t - 8] ^ w[t - 14] ^ w[t - 16], 1);
+				}
+
+				auto [a, b, c, d, e] = std::array { state[0], state[1], state[2], state[3], state[4] };
+
+				auto round = [&](std::size_t t, uint32_t f, uint32_t k) {
+					auto temp = std::rotl(a, 5) + f + e + k + w[t];
+
+					e = d;
+					d = c;
+					c = std::rotl(b, 30);
+					b = a;
+					a = temp;
+				};
+
+				for (std::size_t t = 0; t < 20; t++)
+				{
+					round(t, (b & c) | (~b & d), 0x5a827999);
+				}
+
+				for (std::size_t t = 20; t < 40; t++)
+				{
+					round(t, b ^ c ^ d, 0x6ed9eba1);
+				}
+
+				for (std::size_t t = 40; t < 60; t++)
+				{
+					round(t, (b & c) | (b & d) | (c & d), 0x8f1bbcdc);
+				}
+
+				for (std::size_t t = 60; t < 80; t++)
+				{
+					round(t, b ^ c ^ d, 0xca62c1d6);
+				}
+
+				state[0] += a;
+				state[1] += b;
+				state[2] += c;
+				state[3] += d;
+				state[4] += e;
+			}
+		}
+
+		void sha256_blocks_scalar(uint32_t* state, const std::byte* blocks, std::size_t count)
+		{
+			for (; count; count--, blocks += 64)
+			{
+				std::array<uint32_t, 64> w;
+
+				for (std::size_t t = 0; t < 16; t++)
+				{
+					w[t] = load_be<uint32_t>(blocks + t * 4);
+				}
+
+				for (std::size_t t = 16; t < 64; t++)
+				{
+					auto s0 = std::rotr(w[t - 15], 7) ^ std::rotr(w[t - 15], 18) ^ (w[t - 15] >> 3);
+					auto s1 = std::rotr(w[t - 2], 17) ^ std::rotr(w[t - 2], 19) ^ (w[t - 2] >> 10);
+
+					w[t] = w[t - 16] + s0 + w[t - 7] + s1;
+				}
+
+				auto [a, b, c, d, e, f, g, h] =
+					std::array { state[0], state[1], state[2], state[3], state[4], state[5], state[6], state[7] };
+
+				for (std::size_t t = 0; t < 64; t++)
+				{
+					auto s1 = std::rotr(e, 6) ^ std::rotr(e, 11) ^ std::rotr(e, 25);
+					auto choose = (e & f) ^ (~e & g);
+					auto temp1 = h + s1 + choose + sha256_constants[t] + w[t];
+					auto s0 = std::rotr(a, 2) ^ std::rotr(a, 13) ^ std::rotr(a, 22);
+					auto majority = (a & b) ^ (a & c) ^ (b & c);
+					auto temp2 = s0 + majority;
+
+					h = g;
+					g = f;
+					f = e;
+					e = d + temp1;
+					d = c;
+					c = b;
+					b = a;
+					a = temp1 + temp2;
+				}
+
+				state[0] += a;
+				state[1] += b;
+				state[2] += c;
+				state[3] += d;
+				state[4] += e;
+				state[5] += f;
+				state[6] += g;
+				state[7] += h;
+			}
+		}
+
+		void sha512_blocks_scalar(uint64_t* state, const std::byte* blocks, std::size_t count)
+		{
+			for (; count; count--, blocks += 128)
+			{
+				std::array<uint64_t, 80> w;
+
+				for (std::size_t t = 0; t < 16; t++)
+				{
+					w[t] = load_be<uint64_t>(blocks + t * 8);
+				}
+
+				for (std::size_t t = 16; t < 80; t++)
+				{
+					auto s0 = std::rotr(w[t - 15], 1) ^ std::rotr(w[t - 15], 8) ^ (w[t - 15] >> 7);
+					auto s1 = std::rotr(w[t - 2], 19) ^ std::rotr(w[t - 2], 61) ^ (w[t - 2] >> 6);
+
+					w[t] = w[t - 16] + s0 + w[t - 7] + s1;
+				}
+
+				auto [a, b, c, d, e, f, g, h] =
+					std::array { state[0], state[1], state[2], state[3], state[4], state[5], state[6], state[7] };
+
+				for (std::size_t t = 0; t < 80; t++)
+				{
+					auto s1 = std::rotr(e, 14) ^ std::rotr(e, 18) ^ std::rotr(e, 41);
+					auto choose = (e & f) ^ (~e & g);
+					auto temp1 = h + s1 + choose + sha512_constants[t] + w[t];
+					auto s0 = std::rotr(a, 28) ^ std::rotr(a, 34) ^ std::rotr(a, 39);
+					auto majority = (a & b) ^ (a & c) ^ (b & c);
+					auto temp2 = s0 + majority;
+
+					h = g;
+					g = f;
+					f = e;
+					e = d + temp1;
+					d = c;
+					c = b;
+					b = a;
+					a = temp1 + temp2;
+				}
+
+				state[0] += a;
+				state[1] += b;
+				state[2] += c;
+				state[3] += d;
+				state[4] += e;
+				state[5] += f;
+				state[6] += g;
+				state[7] += h;
+			}
+		}
+
+#if defined(__x86_64__) || defined(__i386__)
+		__attribute__((target("sha,sse4.1"))) void sha1_blocks_sha_ni(
+			uint32_t* state,
+			const std::byte* blocks,
+			std::size_t count
+		)
+		{
+			// Reverses the bytes of the whole register: the instructions expect the first word in the highest lane
+			auto shuffle = _mm_set_epi64x(0x0001020304050607, 0x08090a0b0c0d0e0f);
+
+			auto abcd = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(state)), 0x1b);
+			auto e0 = _mm_set_epi32(static_cast<int>(state[4]), 0, 0, 0);
+
+			for (; count; count--, blocks += 64)
+			{
+				auto abcd_save = abcd;
+				auto e0_save = e0;
+				auto e1 = abcd;
+
+				__m128i w[4];
+
+				// Each step does four rounds. The schedule of step i + 1 to i + 3 is advanced as soon as the words
+				// of step i are known.
+#pragma GCC unroll 20
+				for (std::size_t i = 0; i < 20; i++)
+				{
+					auto& e = i % 2 ? e1 : e0;
+
+					if (i < 4)
+					{
+						w[i] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(blocks) + i), shuffle);
+					}
+
+					if (i == 0)
+					{
+						e0 = _mm_add_epi32(e0, w[0]);
+					}
+					else
+					{
+						e = _mm_sha1nexte_epu32(e, w[i % 4]);
+					}
+
+					(i % 2 ? e0 : e1) = abcd;
+
+					switch (i / 5)
+					{
+					case 0:
+						abcd = _mm_sha1rnds4_epu32(abcd, e, 0);
+						break;
+					case 1:
+						abcd = _mm_sha1rnds4_epu32(abcd, e, 1);
+						break;
+					case 2:
+						abcd = _mm_sha1rnds4_epu32(abcd, e, 2);
+						break;
+					default:
+						abcd = _mm_sha1rnds4_epu32(abcd, e, 3);
+						break;
+					}
+
+					if (i >= 3 && i + 1 < 20)
+					{
+						w[(i + 1) % 4] = _mm_sha1msg2_epu32(w[(i + 1) % 4], w[i % 4]);
+					}
+
+					if (i >= 2 && i + 2 < 20)
+					{
+						w[(i + 2) % 4] = _mm_xor_si128(w[(i + 2) % 4], w[i % 4]);
+					}
+
+					if (i >= 1 && i + 3 < 20)
+					{
+						w[(i + 3) % 4] = _mm_sha1msg1_epu32(w[(i + 3) % 4], w[i % 4]);
+					}
+				}
+
+				e0 = _mm_sha1nexte_epu32(e0, e0_save);
+				abcd = _mm_add_epi32(abcd, abcd_save);
+			}
+
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(state), _mm_shuffle_epi32(abcd, 0x1b));
+			state[4] = static_cast<uint32_t>(_mm_extract_epi32(e0, 3));
+		}
+
+		__attribute__((target("sha,sse4.1"))) void sha256_blocks_sha_ni(
+			uint32_t* state,
+			const std::byte* blocks,
+			std::size_t count
+		)
+		{
+			// Swaps the bytes of each word
+			auto shuffle = _mm_set_epi64x(0x0c0d0e0f08090a0b, 0x0405060700010203);
+
+			// The rounds instruction keeps the state as ABEF and CDGH
+			auto dcba = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(state)), 0xb1);
+			auto hgfe = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(state + 4)), 0x1b);
+			auto abef = _mm_alignr_epi8(dcba, hgfe, 8);
+			auto cdgh = _mm_blend_epi16(hgfe, dcba, 0xf0);
+
+			for (; count; count--, blocks += 64)
+			{
+				auto abef_save = abef;
+				auto cdgh_save = cdgh;
+
+				__m128i w[4];
+
+				// Each step does four rounds on the words w[i % 4], which for later steps are computed from the
+				// words of the four steps before
+#pragma GCC unroll 16
+				for (std::size_t i = 0; i < 16; i++)
+				{
+					auto& words = w[i % 4];
+
+					if (i < 4)
+					{
+						auto input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(blocks) + i);
+
+						words = _mm_shuffle_epi8(input, shuffle);
+					}
+					else
+					{
+						words = _mm_sha256msg1_epu32(words, w[(i + 1) % 4]);
+						words = _mm_add_epi32(words, _mm_alignr_epi8(w[(i + 3) % 4], w[(i + 2) % 4], 4));
+						words = _mm_sha256msg2_epu32(words, w[(i + 3) % 4]);
+					}
+
+					auto message = _mm_add_epi32(
+						words,
+						_mm_load_si128(reinterpret_cast<const __m128i*>(sha256_constants.data() + i * 4))
+					);
+
+					cdgh = _mm_sha256rnds2_epu32(cdgh, abef, message);
+					abef = _mm_sha256rnds2_epu32(abef, cdgh, _mm_shuffle_epi32(message, 0x0e));
+				}
+
+				abef = _mm_add_epi32(abef, abef_save);
+				cdgh = _mm_add_epi32(cdgh, cdgh_save);
+			}
+
+			auto feba = _mm_shuffle_epi32(abef, 0x1b);
+			auto dchg = _mm_shuffle_epi32(cdgh, 0xb1);
+
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(state), _mm_blend_epi16(feba, dchg, 0xf0));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(state + 4), _mm_alignr_epi8(dchg, feba, 8));
+		}
+#endif
+
+		template <typename Word>
+		using sha_blocks_t = void (*)(Word*, const std::byte*, std::size_t);
+
+		sha_blocks_t<uint32_t> select_sha1_blocks()
+		{
+#if defined(__x86_64__) || defined(__i386__)
+			if (__builtin_cpu_supports("sha") && __builtin_cpu_supports("sse4.1"))
+			{
+				return sha1_blocks_sha_ni;
+			}
+#endif
+
+			return sha1_blocks_scalar;
+		}
+
+		sha_blocks_t<uint32_t> select_sha256_blocks()
+		{
+#if defined(__x86_64__) || defined(__i386__)
+			if (__builtin_cpu_supports("sha") && __builtin_cpu_supports("sse4.1"))
+			{
+				return sha256_blocks_sha_ni;
+			}
+#endif
+
+			return sha256_blocks_scalar;
+		}
+
+		// Pads the input, runs it through the compression function and writes the first size(output) bytes of the
+		// final state to output, up to the whole state
+		template <typename Word, std::size_t StateSize>
+		void sha_hash(
+			std::array<Word, StateSize> state,
+			sha_blocks_t<Word> blocks,
+			std::span<const std::byte> input,
+			std::span<std::byte> output
+		)
+		{
+			constexpr std::size_t block_size = sizeof(Word) * 16;
+			// The message length is stored in two words, of which only the lower 64 bits are ever used here
+			constexpr std::size_t length_size = sizeof(Word) * 2;
+
+			auto full_blocks = size(input) / block_size;
+
+			if (full_blocks)
+			{
+				blocks(state.data(), input.data(), full_blocks);
+			}
+
+			auto rest = input.subspan(full_blocks * block_size);
+			std::array<std::byte, block_size * 2> tail {};
+
+			std::memcpy(tail.data(), rest.data(), size(rest));
+			tail[size(rest)] = std::byte(0x80);
+
+			auto tail_blocks = size(rest) + 1 + length_size > block_size ? 2 : 1;
+
+			store_be(tail.data() + tail_blocks * block_size - sizeof(uint64_t), uint64_t(size(input)) * 8);
+
+			blocks(state.data(), tail.data(), tail_blocks);
+
+			for (std::size_t i = 0; i < std::min(StateSize, size(output) / sizeof(Word)); i++)
+			{
+				store_be(output.data() + i * sizeof(Word), state[i]);
+			}
+		}
+	} // namespace details
+
+	// Whether hash can compute digests of an algorithm
+	constexpr bool can_hash(uint16_t hash_alg)
+	{
+		switch (hash_alg)
+		{
+		case TPM_ALG_SHA1:
+		case TPM_ALG_SHA256:
+		case TPM_ALG_SHA384:
+		case TPM_ALG_SHA512:
+			return true;
+		}
+
+		return false;
+	}
+
+	// Computes the digest of input. SHA-1 and SHA-256 use the SHA instructions if the CPU supports them. Returns an
+	// empty digest for algorithms can_hash rejects.
+	digest hash(uint16_t hash_alg, std::span<const std::byte> input)
+	{
+		static const auto sha1_kernel = details::select_sha1_blocks();
+		static const auto sha256_kernel = details::select_sha256_blocks();
+
+		std::array<std::byte, digest::max_size> output;
+		auto value = std::span(output).first(digest_size(hash_alg));
+
+		switch (hash_alg)
+		{
+		case TPM_ALG_SHA1:
+			details::sha_hash(details::sha1_initial, sha1_kernel, input, value);
+			break;
+		case TPM_ALG_SHA256:
+			details::sha_hash(details::sha256_initial, sha256_kernel, input, value);
+			break;
+		case TPM_ALG_SHA384:
+			details::sha_hash(details::sha384_initial, details::sha512_blocks_scalar, input, value);
+			break;
+		case TPM_ALG_SHA512:
+			details::sha_hash(details::sha512_initial, details::sha512_blocks_scalar, input, value);
+			break;
+		default:
+			return {};
+		}
+
+		return digest(hash_alg, value);
+	}
+} // namespace tcg_parser
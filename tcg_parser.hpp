@@ -1,16 +1,21 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <iostream>
 #include <optional>
-#include <sstream>
+#include <span>
 #include <unordered_map>
 #include <vector>
 
 #include "device_path.hpp"
+#include "digest_bank.hpp"
 #include "events.hpp"
+#include "hash_algorithms.hpp"
+#include "parse_limits.hpp"
 
 using namespace std::string_view_literals;
 
@@ -125,8 +130,10 @@ namespace tcg_parser
 	{
 		uint32_t pcr_index;
 		uint32_t event_type;
-		std::vector<std::string> digests;
+		digest_bank digests;
 		event_payload_t event;
+
+		bool operator==(const tcg_pgr_event_2&) const = default;
 	};
 
 	struct tcg_pgr_event_1
@@ -135,49 +142,84 @@ namespace tcg_parser
 		uint32_t event_type;
 		std::array<char, 20> digest;
 		event_payload_t event;
+
+		bool operator==(const tcg_pgr_event_1&) const = default;
 	};
 
 #pragma pack(pop)
 
+	// The framing of a tcg_pgr_event_2, with its digests and event data left in the input
+	struct tcg_pgr_event_2_view
+	{
+		uint32_t pcr_index;
+		uint32_t event_type;
+		uint32_t digest_count;
+		std::span<const std::byte> digests;
+		std::span<const std::byte> event;
+		// The algorithm and size of each digest, when the event was framed for the log's set of hash algorithms
+		std::span<const events::efi_spec_id::digest_size> digest_layout;
+	};
+
 	namespace details
 	{
+		// The PCR index, event type and digest count that start every tcg_pgr_event_2
+		constexpr std::size_t event_2_header_size = 3 * sizeof(uint32_t);
+	} // namespace details
+
+	namespace details
+	{
+		events::raw_event_t read_raw(std::span<const std::byte> buffer)
+		{
+			return events::raw_event_t(reinterpret_cast<const char*>(buffer.data()), size(buffer));
+		}
+
 		template <typename T>
-		std::optional<T> read_variable(std::istream& stream)
+		std::optional<T> read_variable(span_reader& reader, const parse_limits& limits)
 		{
 			T event;
 
-			if (stream.read(reinterpret_cast<char*>(&event), offsetof(events::efi_variable_boot, unicode_name));
-				!stream.good())
+			if (!reader.read(&event, offsetof(events::efi_variable_boot, unicode_name)))
 			{
 				return {};
 			}
 
 			uint64_t unicode_name_length;
 
-			if (stream.read(reinterpret_cast<char*>(&unicode_name_length), sizeof(unicode_name_length)); !stream.good())
+			if (!reader.read(&unicode_name_length, sizeof(unicode_name_length)))
 			{
 				return {};
 			}
 
 			uint64_t variable_data_length;
 
-			if (stream.read(reinterpret_cast<char*>(&variable_data_length), sizeof(variable_data_length));
-				!stream.good())
+			if (!reader.read(&variable_data_length, sizeof(variable_data_length)))
+			{
+				return {};
+			}
+
+			// Both lengths are checked before anything is allocated for them
+			if (unicode_name_length > limits.max_variable_name_length ||
+				unicode_name_length > size(reader.remaining()) / sizeof(char16_t))
+			{
+				return {};
+			}
+
+			if (variable_data_length > limits.max_variable_data_length ||
+				variable_data_length > size(reader.remaining()) - unicode_name_length * sizeof(char16_t))
 			{
 				return {};
 			}
 
 			event.unicode_name.resize(unicode_name_length);
 
-			if (stream.read(reinterpret_cast<char*>(event.unicode_name.data()), unicode_name_length * sizeof(char16_t));
-				!stream.good())
+			if (!reader.read(event.unicode_name.data(), unicode_name_length * sizeof(char16_t)))
 			{
 				return {};
 			}
 
 			event.variable_data.resize(variable_data_length);
 
-			if (stream.read(reinterpret_cast<char*>(event.variable_data.data()), variable_data_length); !stream.good())
+			if (!reader.read(event.variable_data.data(), variable_data_length))
 			{
 				return {};
 			}
@@ -186,37 +228,37 @@ namespace tcg_parser
 		}
 
 		template <typename T>
-		std::optional<T> read_image(std::istream& stream)
+		std::optional<T> read_image(span_reader& reader)
 		{
 			T event;
 
-			if (stream.read(reinterpret_cast<char*>(&event), offsetof(events::efi_boot_services_application, device_path));
-				!stream.good())
+			if (!reader.read(&event, offsetof(events::efi_boot_services_application, device_path)))
 			{
 				return {};
 			}
 
 			uint64_t size_of_device_path;
 
-			if (stream.read(reinterpret_cast<char*>(&size_of_device_path), sizeof(size_of_device_path)); !stream.good())
+			if (!reader.read(&size_of_device_path, sizeof(size_of_device_path)))
 			{
 				return {};
 			}
 
 			if (size_of_device_path)
 			{
-				event.device_path = tcg_parser::device_path::parse(stream);
+				event.device_path =
+					device_path_buffer(reader.take(std::min<uint64_t>(size_of_device_path, size(reader.remaining()))));
 			}
 
 			return event;
 		}
 
 		template <typename T>
-		std::optional<T> read_struct(std::istream& stream)
+		std::optional<T> read_struct(auto& reader)
 		{
 			T event;
 
-			if (stream.read(reinterpret_cast<char*>(&event), sizeof(event)); !stream.good())
+			if (!reader.read(&event, sizeof(event)))
 			{
 				return {};
 			}
@@ -225,30 +267,30 @@ namespace tcg_parser
 		}
 
 		template <typename T>
-		std::optional<T> read_blob(std::istream& stream)
+		std::optional<T> read_blob(auto& reader)
 		{
 			T event;
 
 			uint8_t description_size;
 
-			if (stream.read(reinterpret_cast<char*>(&description_size), sizeof(description_size)); !stream.good())
+			if (!reader.read(&description_size, sizeof(description_size)))
 			{
 				return {};
 			}
 
 			event.blob_description.resize(description_size);
 
-			if (stream.read(event.blob_description.data(), description_size); !stream.good())
+			if (!reader.read(event.blob_description.data(), description_size))
 			{
 				return {};
 			}
 
-			if (stream.read(reinterpret_cast<char*>(&event.blob_base), sizeof(event.blob_base)); !stream.good())
+			if (!reader.read(&event.blob_base, sizeof(event.blob_base)))
 			{
 				return {};
 			}
 
-			if (stream.read(reinterpret_cast<char*>(&event.blob_length), sizeof(event.blob_length)); !stream.good())
+			if (!reader.read(&event.blob_length, sizeof(event.blob_length)))
 			{
 				return {};
 			}
@@ -257,15 +299,15 @@ namespace tcg_parser
 		}
 
 		template <typename T>
-		std::optional<T> read_string(std::istream& stream)
+		std::optional<T> read_string(auto& reader)
 		{
 			T event;
 
-			while (stream.good())
+			while (reader.good())
 			{
 				char16_t character;
 
-				if (stream.read(reinterpret_cast<char*>(&character), sizeof(character)); !character)
+				if (!reader.read(&character, sizeof(character)) || !character)
 				{
 					break;
 				}
@@ -277,22 +319,22 @@ namespace tcg_parser
 		}
 
 		template <typename T>
-		std::optional<T> read_string_or_blob(std::istream& stream, const std::string& buffer)
+		std::optional<T> read_string_or_blob(auto& reader, std::span<const std::byte> buffer)
 		{
 			for (auto character : buffer)
 			{
-				if (!std::isprint(character))
+				if (!std::isprint(static_cast<char>(character)))
 				{
 					if (size(buffer) == sizeof(events::uefi_blob_1))
 					{
-						if (auto blob = details::read_struct<events::uefi_blob_1>(stream))
+						if (auto blob = details::read_struct<events::uefi_blob_1>(reader))
 						{
 							return T {
 								.data = *blob,
 							};
 						}
 					}
-					else if (auto blob = details::read_blob<events::uefi_blob_2>(stream))
+					else if (auto blob = details::read_blob<events::uefi_blob_2>(reader))
 					{
 						return T {
 							.data = *blob,
@@ -306,27 +348,32 @@ namespace tcg_parser
 			}
 
 			return T {
-				.data = buffer,
+				.data = read_raw(buffer),
 			};
 		}
 	}
 
-	event_payload_t read_event_payload(const auto& header, const std::string& buffer)
+	// Decodes the payload of an event, or keeps its event data as is if it cannot be decoded within the limits
+	event_payload_t read_event_payload(
+		const auto& header,
+		std::span<const std::byte> buffer,
+		const parse_limits& limits
+	)
 	{
 		using std::size;
 
-		std::istringstream stream(buffer);
+		details::span_reader reader(buffer);
 
 		if constexpr (std::same_as<decltype(header), const tcg_pgr_event_1&>)
 		{
 			if (header.pcr_index != 0)
 			{
-				return buffer;
+				return details::read_raw(buffer);
 			}
 
 			if (header.event_type != EV_NO_ACTION)
 			{
-				return buffer;
+				return details::read_raw(buffer);
 			}
 
 			auto is_not_zero = [](auto c) {
@@ -335,46 +382,49 @@ namespace tcg_parser
 
 			if (std::ranges::any_of(header.digest, is_not_zero))
 			{
-				return buffer;
+				return details::read_raw(buffer);
 			}
 
 			events::efi_spec_id event;
 
-			if (stream.read(reinterpret_cast<char*>(&event), offsetof(events::efi_spec_id, digest_sizes));
-				!stream.good())
+			if (!reader.read(&event, offsetof(events::efi_spec_id, digest_sizes)))
 			{
-				return buffer;
+				return details::read_raw(buffer);
 			}
 
 			uint32_t number_of_algorithms;
 
-			if (stream.read(reinterpret_cast<char*>(&number_of_algorithms), sizeof(number_of_algorithms));
-				!stream.good())
+			if (!reader.read(&number_of_algorithms, sizeof(number_of_algorithms)))
+			{
+				return details::read_raw(buffer);
+			}
+
+			if (number_of_algorithms > limits.max_algorithms ||
+				number_of_algorithms > size(reader.remaining()) / sizeof(events::efi_spec_id::digest_size))
 			{
-				return buffer;
+				return details::read_raw(buffer);
 			}
 
 			event.digest_sizes.resize(number_of_algorithms);
 
-			if (stream.read(
-					reinterpret_cast<char*>(event.digest_sizes.data()),
+			if (!reader.read(
+					event.digest_sizes.data(),
 					number_of_algorithms * sizeof(events::efi_spec_id::digest_size)
-				);
-				!stream.good())
+				))
 			{
-				return buffer;
+				return details::read_raw(buffer);
 			}
 
 			uint8_t vendor_info_size;
 
-			if (stream.read(reinterpret_cast<char*>(&vendor_info_size), sizeof(vendor_info_size)); !stream.good())
+			if (!reader.read(&vendor_info_size, sizeof(vendor_info_size)))
 			{
-				return buffer;
+				return details::read_raw(buffer);
 			}
 
 			event.vendor_info.resize(vendor_info_size);
 
-			stream.read(event.vendor_info.data(), vendor_info_size);
+			reader.read(event.vendor_info.data(), vendor_info_size);
 
 			return event;
 		}
@@ -383,36 +433,36 @@ namespace tcg_parser
 			switch (header.event_type)
 			{
 			case EV_S_CRTM_VERSION:
-				return details::read_string<events::s_crtm_version>(stream);
+				return details::read_string<events::s_crtm_version>(reader);
 			case EV_EFI_HCRTM_EVENT:
-				return details::read_string_or_blob<events::efi_hcrtm>(stream, buffer);
+				return details::read_string_or_blob<events::efi_hcrtm>(reader, buffer);
 			case EV_EFI_PLATFORM_FIRMWARE_BLOB:
-				return details::read_struct<events::efi_platform_firmware_blob>(stream);
+				return details::read_struct<events::efi_platform_firmware_blob>(reader);
 			case EV_EFI_VARIABLE_DRIVER_CONFIG:
-				return details::read_variable<events::efi_variable_driver_config>(stream);
+				return details::read_variable<events::efi_variable_driver_config>(reader, limits);
 			case EV_EFI_BOOT_SERVICES_APPLICATION:
-				return details::read_image<events::efi_boot_services_application>(stream);
+				return details::read_image<events::efi_boot_services_application>(reader);
 			case EV_EFI_BOOT_SERVICES_DRIVER:
-				return details::read_image<events::efi_boot_services_driver>(stream);
+				return details::read_image<events::efi_boot_services_driver>(reader);
 			case EV_EFI_RUNTIME_SERVICES_DRIVER:
-				return details::read_image<events::efi_runtime_services_driver>(stream);
+				return details::read_image<events::efi_runtime_services_driver>(reader);
 			case EV_EFI_VARIABLE_BOOT:
-				return details::read_variable<events::efi_variable_boot>(stream);
+				return details::read_variable<events::efi_variable_boot>(reader, limits);
 			case EV_POST_CODE:
-				return details::read_string_or_blob<events::post_code>(stream, buffer);
+				return details::read_string_or_blob<events::post_code>(reader, buffer);
 			case EV_EFI_ACTION:
 				return events::efi_action {
-					.data = buffer,
+					.data = details::read_raw(buffer),
 				};
 			case EV_IPL:
-				return details::read_string<events::ipl>(stream);
+				return details::read_string<events::ipl>(reader);
 			case EV_SEPARATOR:
 				return events::separator {};
 			case EV_EFI_VARIABLE_AUTHORITY:
-				return details::read_variable<events::efi_variable_authority>(stream);
+				return details::read_variable<events::efi_variable_authority>(reader, limits);
 			}
 
-			return buffer;
+			return details::read_raw(buffer);
 		};
 
 		if (auto event = read_event())
@@ -420,15 +470,491 @@ namespace tcg_parser
 			return *event;
 		}
 
-		return buffer;
+		return details::read_raw(buffer);
+	}
+
+	event_payload_t read_event_payload(const auto& header, std::span<const std::byte> buffer)
+	{
+		return read_event_payload(header, buffer, parse_limits());
+	}
+
+	event_payload_t read_event_payload(const auto& header, const std::string& buffer)
+	{
+		return read_event_payload(header, std::as_bytes(std::span(buffer)));
 	}
 
 	using event_header_t = std::variant<tcg_pgr_event_1, tcg_pgr_event_2>;
 
+	std::optional<tcg_pgr_event_2_view> read_event_2_view(
+		std::span<const std::byte>& input,
+		const std::vector<events::efi_spec_id::digest_size>& digest_sizes
+	)
+	{
+		details::span_reader reader(input);
+
+		tcg_pgr_event_2_view view;
+
+		if (!reader.read(&view.pcr_index, sizeof(view.pcr_index)) ||
+			!reader.read(&view.event_type, sizeof(view.event_type)) ||
+			!reader.read(&view.digest_count, sizeof(view.digest_count)))
+		{
+			return {};
+		}
+
+		auto digests = reader.remaining();
+
+		for (auto i = 0u; i < view.digest_count; i++)
+		{
+			uint16_t hash_alg;
+
+			if (!reader.read(&hash_alg, sizeof(hash_alg)))
+			{
+				return {};
+			}
+
+			auto entry = std::ranges::find_if(digest_sizes, [hash_alg](auto entry) {
+				return entry.hash_alg == hash_alg;
+			});
+
+			if (entry == end(digest_sizes) || entry->digest_size > digest::max_size)
+			{
+				return {};
+			}
+
+			if (!reader.skip(entry->digest_size))
+			{
+				return {};
+			}
+		}
+
+		view.digests = digests.first(size(digests) - size(reader.remaining()));
+
+		uint32_t event_size;
+
+		if (!reader.read(&event_size, sizeof(event_size)))
+		{
+			return {};
+		}
+
+		view.event = reader.take(event_size);
+
+		if (!reader.good())
+		{
+			return {};
+		}
+
+		input = reader.remaining();
+
+		return view;
+	}
+
+	namespace details
+	{
+		// The digests of every event of a log whose hash algorithms are Algorithms, in that order
+		template <uint16_t... Algorithms>
+		constexpr std::array<events::efi_spec_id::digest_size, sizeof...(Algorithms)> digest_layout = {
+			events::efi_spec_id::digest_size { .hash_alg = Algorithms, .digest_size = digest_size(Algorithms) }...
+		};
+
+		template <uint16_t... Algorithms>
+		std::optional<tcg_pgr_event_2_view> read_event_2_view(
+			std::span<const std::byte>& input,
+			const std::vector<events::efi_spec_id::digest_size>& digest_sizes
+		)
+		{
+			constexpr std::array<uint16_t, sizeof...(Algorithms)> algorithms = { Algorithms... };
+			constexpr auto digests_offset = event_2_header_size;
+			constexpr auto event_size_offset = digests_offset + ((sizeof(uint16_t) + digest_size(Algorithms)) + ...);
+			constexpr auto event_offset = event_size_offset + sizeof(uint32_t);
+
+			if (size(input) < event_offset)
+			{
+				return tcg_parser::read_event_2_view(input, digest_sizes);
+			}
+
+			uint32_t pcr_index;
+			uint32_t event_type;
+			uint32_t digest_count;
+
+			std::memcpy(&pcr_index, input.data(), sizeof(pcr_index));
+			std::memcpy(&event_type, input.data() + sizeof(pcr_index), sizeof(event_type));
+			std::memcpy(&digest_count, input.data() + sizeof(pcr_index) + sizeof(event_type), sizeof(digest_count));
+
+			if (digest_count != size(algorithms))
+			{
+				return tcg_parser::read_event_2_view(input, digest_sizes);
+			}
+
+			auto offset = digests_offset;
+
+			for (auto algorithm : algorithms)
+			{
+				uint16_t hash_alg;
+
+				std::memcpy(&hash_alg, input.data() + offset, sizeof(hash_alg));
+
+				if (hash_alg != algorithm)
+				{
+					return tcg_parser::read_event_2_view(input, digest_sizes);
+				}
+
+				offset += sizeof(hash_alg) + digest_size(algorithm);
+			}
+
+			uint32_t event_size;
+
+			std::memcpy(&event_size, input.data() + event_size_offset, sizeof(event_size));
+
+			if (size(input) - event_offset < event_size)
+			{
+				return {};
+			}
+
+			tcg_pgr_event_2_view view {
+				.pcr_index = pcr_index,
+				.event_type = event_type,
+				.digest_count = digest_count,
+				.digests = input.subspan(digests_offset, event_size_offset - digests_offset),
+				.event = input.subspan(event_offset, event_size),
+				.digest_layout = digest_layout<Algorithms...>,
+			};
+
+			input = input.subspan(event_offset + event_size);
+
+			return view;
+		}
+	} // namespace details
+
+	// Frames events of one log, using a framer specialized for its set of hash algorithms when there is one.
+	class event_framer
+	{
+	public:
+		explicit event_framer(const std::vector<events::efi_spec_id::digest_size>& digest_sizes)
+			: m_digest_sizes(&digest_sizes)
+			, m_read(select(digest_sizes))
+		{
+		}
+
+		std::optional<tcg_pgr_event_2_view> operator()(std::span<const std::byte>& input) const
+		{
+			return m_read(input, *m_digest_sizes);
+		}
+
+		const std::vector<events::efi_spec_id::digest_size>& digest_sizes() const
+		{
+			return *m_digest_sizes;
+		}
+
+	private:
+		using read_t = std::optional<tcg_pgr_event_2_view> (*)(
+			std::span<const std::byte>&,
+			const std::vector<events::efi_spec_id::digest_size>&
+		);
+
+		template <uint16_t... Algorithms>
+		static bool matches(const std::vector<events::efi_spec_id::digest_size>& digest_sizes)
+		{
+			constexpr std::array<uint16_t, sizeof...(Algorithms)> algorithms = { Algorithms... };
+
+			return std::ranges::equal(digest_sizes, algorithms, [](auto entry, auto algorithm) {
+				return entry.hash_alg == algorithm && entry.digest_size == digest_size(algorithm);
+			});
+		}
+
+		static read_t select(const std::vector<events::efi_spec_id::digest_size>& digest_sizes)
+		{
+			if (matches<TPM_ALG_SHA1, TPM_ALG_SHA256>(digest_sizes))
+			{
+				return details::read_event_2_view<TPM_ALG_SHA1, TPM_ALG_SHA256>;
+			}
+
+			if (matches<TPM_ALG_SHA256>(digest_sizes))
+			{
+				return details::read_event_2_view<TPM_ALG_SHA256>;
+			}
+
+			if (matches<TPM_ALG_SHA1, TPM_ALG_SHA256, TPM_ALG_SHA384>(digest_sizes))
+			{
+				return details::read_event_2_view<TPM_ALG_SHA1, TPM_ALG_SHA256, TPM_ALG_SHA384>;
+			}
+
+			if (matches<TPM_ALG_SHA256, TPM_ALG_SHA384>(digest_sizes))
+			{
+				return details::read_event_2_view<TPM_ALG_SHA256, TPM_ALG_SHA384>;
+			}
+
+			if (matches<TPM_ALG_SHA1>(digest_sizes))
+			{
+				return details::read_event_2_view<TPM_ALG_SHA1>;
+			}
+
+			return tcg_parser::read_event_2_view;
+		}
+
+		const std::vector<events::efi_spec_id::digest_size>* m_digest_sizes;
+		read_t m_read;
+	};
+
+	namespace details
+	{
+		// Calls function with the algorithm and bytes of every digest of an event, stopping at the first one that
+		// cannot be read or whose algorithm is not in the digest sizes. The digests of an event framed for the log's
+		// set of hash algorithms are walked with the sizes the framer matched, without looking any up.
+		void for_each_digest(
+			const tcg_pgr_event_2_view& view,
+			const std::vector<events::efi_spec_id::digest_size>& digest_sizes,
+			auto&& function
+		)
+		{
+			if (!view.digest_layout.empty())
+			{
+				std::size_t offset = 0;
+
+				for (auto entry : view.digest_layout)
+				{
+					offset += sizeof(entry.hash_alg);
+
+					function(entry.hash_alg, view.digests.subspan(offset, entry.digest_size));
+
+					offset += entry.digest_size;
+				}
+
+				return;
+			}
+
+			span_reader reader(view.digests);
+
+			for (auto i = 0u; i < view.digest_count; i++)
+			{
+				uint16_t hash_alg;
+
+				if (!reader.read(&hash_alg, sizeof(hash_alg)))
+				{
+					return;
+				}
+
+				auto entry = std::ranges::find_if(digest_sizes, [hash_alg](auto entry) {
+					return entry.hash_alg == hash_alg;
+				});
+
+				if (entry == end(digest_sizes))
+				{
+					return;
+				}
+
+				auto digest = reader.take(entry->digest_size);
+
+				if (!reader.good())
+				{
+					return;
+				}
+
+				function(hash_alg, digest);
+			}
+		}
+	} // namespace details
+
+	// Holds the framing of an event and decodes its payload the first time it is requested.
+	// Refers into the input and the digest sizes it was read with, which must outlive it.
+	class tcg_pgr_lazy_event_2
+	{
+	public:
+		tcg_pgr_lazy_event_2(
+			const tcg_pgr_event_2_view& view,
+			const std::vector<events::efi_spec_id::digest_size>& digest_sizes
+		)
+			: m_view(view)
+			, m_digest_sizes(&digest_sizes)
+		{
+		}
+
+		uint32_t pcr_index() const
+		{
+			return m_view.pcr_index;
+		}
+
+		uint32_t event_type() const
+		{
+			return m_view.event_type;
+		}
+
+		std::span<const std::byte> digest(uint16_t hash_alg) const
+		{
+			std::span<const std::byte> result;
+
+			for_each_digest([&](uint16_t entry, std::span<const std::byte> digest) {
+				if (entry == hash_alg)
+				{
+					result = digest;
+				}
+			});
+
+			return result;
+		}
+
+		digest_bank digests() const
+		{
+			digest_bank digests;
+
+			for_each_digest([&](uint16_t hash_alg, std::span<const std::byte> digest) {
+				digests.push_back(hash_alg, digest);
+			});
+
+			return digests;
+		}
+
+		void for_each_digest(auto&& function) const
+		{
+			details::for_each_digest(m_view, *m_digest_sizes, function);
+		}
+
+		std::span<const std::byte> data() const
+		{
+			return m_view.event;
+		}
+
+		const event_payload_t& event() const
+		{
+			if (!m_event)
+			{
+				m_event = read_event_payload(m_view, m_view.event);
+			}
+
+			return *m_event;
+		}
+
+	private:
+		tcg_pgr_event_2_view m_view;
+		const std::vector<events::efi_spec_id::digest_size>* m_digest_sizes;
+		mutable std::optional<event_payload_t> m_event;
+	};
+
+	std::optional<tcg_pgr_lazy_event_2> read_lazy_event_2(std::span<const std::byte>& input, const event_framer& framer)
+	{
+		if (auto view = framer(input))
+		{
+			return tcg_pgr_lazy_event_2(*view, framer.digest_sizes());
+		}
+
+		return {};
+	}
+
+	std::optional<tcg_pgr_lazy_event_2> read_lazy_event_2(
+		std::span<const std::byte>& input,
+		const std::vector<events::efi_spec_id::digest_size>& digest_sizes
+	)
+	{
+		return read_lazy_event_2(input, event_framer(digest_sizes));
+	}
+
+	tcg_pgr_event_2 decode_event_2(
+		const tcg_pgr_event_2_view& view,
+		const std::vector<events::efi_spec_id::digest_size>& digest_sizes,
+		const parse_limits& limits
+	)
+	{
+		tcg_pgr_event_2 header {
+			.pcr_index = view.pcr_index,
+			.event_type = view.event_type,
+		};
+
+		details::for_each_digest(view, digest_sizes, [&](uint16_t hash_alg, std::span<const std::byte> digest) {
+			header.digests.push_back(hash_alg, digest);
+		});
+
+		header.event = read_event_payload(header, view.event, limits);
+
+		return header;
+	}
+
+	tcg_pgr_event_2 decode_event_2(
+		const tcg_pgr_event_2_view& view,
+		const std::vector<events::efi_spec_id::digest_size>& digest_sizes
+	)
+	{
+		return decode_event_2(view, digest_sizes, parse_limits());
+	}
+
+	namespace details
+	{
+		// Reads event data from a stream into a buffer that grows as the bytes arrive, so that an event size the
+		// stream does not hold costs no more memory than the bytes it does
+		bool read_event_data(std::istream& stream, std::string& buffer, std::size_t event_size)
+		{
+			constexpr std::size_t chunk_size = 64 * 1024;
+
+			buffer.clear();
+
+			while (buffer.size() < event_size)
+			{
+				auto offset = buffer.size();
+
+				buffer.resize(offset + std::min(chunk_size, event_size - offset));
+
+				if (stream.read(buffer.data() + offset, buffer.size() - offset); !stream.good())
+				{
+					return false;
+				}
+			}
+
+			return true;
+		}
+	} // namespace details
+
+	// Reads an event within the budget of its log. Fails without consuming the event if its event data does not fit.
 	std::optional<tcg_pgr_event_2> read_event_2(
-		std::istream& stream,
+		std::span<const std::byte>& input,
+		const event_framer& framer,
+		parse_budget& budget
+	)
+	{
+		auto remaining = input;
+		auto view = framer(remaining);
+
+		if (!view || !budget.take(size(view->event)))
+		{
+			return {};
+		}
+
+		input = remaining;
+
+		return decode_event_2(*view, framer.digest_sizes(), budget.limits());
+	}
+
+	std::optional<tcg_pgr_event_2> read_event_2(std::span<const std::byte>& input, const event_framer& framer)
+	{
+		parse_budget budget;
+
+		return read_event_2(input, framer, budget);
+	}
+
+	// Picks the framer for the digest sizes on every call. Reading a whole log through one event_framer picks it once.
+	std::optional<tcg_pgr_event_2> read_event_2(
+		std::span<const std::byte>& input,
+		const std::vector<events::efi_spec_id::digest_size>& digest_sizes,
+		parse_budget& budget
+	)
+	{
+		return read_event_2(input, event_framer(digest_sizes), budget);
+	}
+
+	std::optional<tcg_pgr_event_2> read_event_2(
+		std::span<const std::byte>& input,
 		const std::vector<events::efi_spec_id::digest_size>& digest_sizes
 	)
+	{
+		parse_budget budget;
+
+		return read_event_2(input, event_framer(digest_sizes), budget);
+	}
+
+	// Reads an event within the budget of its log. Nothing is allocated for event data that is over budget or that
+	// the stream does not hold.
+	std::optional<tcg_pgr_event_2> read_event_2(
+		std::istream& stream,
+		const std::vector<events::efi_spec_id::digest_size>& digest_sizes,
+		parse_budget& budget
+	)
 	{
 		using std::size;
 
@@ -469,14 +995,22 @@ namespace tcg_parser
 				return {};
 			}
 
-			std::string digest(entry->digest_size, '\0');
+			std::array<std::byte, digest::max_size> value;
 
-			if (stream.read(digest.data(), size(digest)); !stream.good())
+			if (entry->digest_size > size(value))
 			{
 				return {};
 			}
 
-			header.digests.push_back(digest);
+			if (stream.read(reinterpret_cast<char*>(value.data()), entry->digest_size); !stream.good())
+			{
+				return {};
+			}
+
+			if (!header.digests.push_back(hash_alg, std::span(value).first(entry->digest_size)))
+			{
+				return {};
+			}
 		}
 
 		uint32_t event_size;
@@ -486,16 +1020,68 @@ namespace tcg_parser
 			return {};
 		}
 
-		std::string buffer(event_size, '\0');
+		std::string buffer;
 
-		stream.read(buffer.data(), buffer.size());
+		if (!budget.take(event_size) || !details::read_event_data(stream, buffer, event_size))
+		{
+			return {};
+		}
 
-		header.event = read_event_payload(header, buffer);
+		header.event = read_event_payload(header, std::as_bytes(std::span(buffer)), budget.limits());
 
 		return header;
 	}
 
-	std::optional<tcg_pgr_event_1> read_event_1(std::istream& stream)
+	std::optional<tcg_pgr_event_2> read_event_2(
+		std::istream& stream,
+		const std::vector<events::efi_spec_id::digest_size>& digest_sizes
+	)
+	{
+		parse_budget budget;
+
+		return read_event_2(stream, digest_sizes, budget);
+	}
+
+	std::optional<tcg_pgr_event_1> read_event_1(std::span<const std::byte>& input, parse_budget& budget)
+	{
+		details::span_reader reader(input);
+
+		tcg_pgr_event_1 header;
+
+		if (!reader.read(&header, offsetof(tcg_pgr_event_1, event)))
+		{
+			return {};
+		}
+
+		uint32_t event_size;
+
+		if (!reader.read(&event_size, sizeof(event_size)))
+		{
+			return {};
+		}
+
+		auto buffer = reader.take(event_size);
+
+		if (!reader.good() || !budget.take(event_size))
+		{
+			return {};
+		}
+
+		header.event = read_event_payload(header, buffer, budget.limits());
+
+		input = reader.remaining();
+
+		return header;
+	}
+
+	std::optional<tcg_pgr_event_1> read_event_1(std::span<const std::byte>& input)
+	{
+		parse_budget budget;
+
+		return read_event_1(input, budget);
+	}
+
+	std::optional<tcg_pgr_event_1> read_event_1(std::istream& stream, parse_budget& budget)
 	{
 		using std::size;
 
@@ -518,12 +1104,22 @@ namespace tcg_parser
 			return {};
 		}
 
-		std::string buffer(event_size, '\0');
+		std::string buffer;
 
-		stream.read(buffer.data(), buffer.size());
+		if (!budget.take(event_size) || !details::read_event_data(stream, buffer, event_size))
+		{
+			return {};
+		}
 
-		header.event = read_event_payload(header, buffer);
+		header.event = read_event_payload(header, std::as_bytes(std::span(buffer)), budget.limits());
 
 		return header;
 	}
+
+	std::optional<tcg_pgr_event_1> read_event_1(std::istream& stream)
+	{
+		parse_budget budget;
+
+		return read_event_1(stream, budget);
+	}
 } // namespace tcg_parser
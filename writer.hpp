@@ -0,0 +1,438 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+#include "tcg_parser.hpp"
+
+namespace tcg_parser
+{
+	namespace details
+	{
+		void write_bytes(std::vector<std::byte>& output, const void* source, std::size_t size)
+		{
+			auto bytes = static_cast<const std::byte*>(source);
+
+			output.insert(end(output), bytes, bytes + size);
+		}
+
+		template <typename T>
+			requires std::is_trivially_copyable_v<T>
+		void write_value(std::vector<std::byte>& output, const T& value)
+		{
+			write_bytes(output, &value, sizeof(value));
+		}
+
+		// Writes the characters as UTF-16 followed by a null character, the way read_string expects them
+		void write_string(std::vector<std::byte>& output, const auto& text)
+		{
+			for (auto character : text)
+			{
+				using unsigned_t = std::make_unsigned_t<decltype(character)>;
+
+				write_value(output, static_cast<char16_t>(static_cast<unsigned_t>(character)));
+			}
+
+			write_value(output, char16_t(0));
+		}
+
+		// Writes a 32-bit size before whatever write appends after it. Fails and leaves the output as it was if
+		// write fails or appends more than fits in the size.
+		bool write_sized(std::vector<std::byte>& output, auto&& write)
+		{
+			auto start = size(output);
+
+			write_value(output, uint32_t(0));
+
+			if (!write() || size(output) - start - sizeof(uint32_t) > std::numeric_limits<uint32_t>::max())
+			{
+				output.resize(start);
+
+				return false;
+			}
+
+			auto length = static_cast<uint32_t>(size(output) - start - sizeof(uint32_t));
+
+			std::memcpy(output.data() + start, &length, sizeof(length));
+
+			return true;
+		}
+	} // namespace details
+
+	namespace device_path
+	{
+		namespace details
+		{
+			template <typename T>
+			constexpr std::pair<uint8_t, uint8_t> node_type = { 0, 0 };
+
+			template <>
+			constexpr std::pair<uint8_t, uint8_t> node_type<hardware::pci> = { 0x1, 0x1 };
+
+			template <>
+			constexpr std::pair<uint8_t, uint8_t> node_type<hardware::mmio> = { 0x1, 0x3 };
+
+			template <>
+			constexpr std::pair<uint8_t, uint8_t> node_type<acpi::acpi> = { 0x2, 0x1 };
+
+			template <>
+			constexpr std::pair<uint8_t, uint8_t> node_type<acpi::extended_acpi> = { 0x2, 0x2 };
+
+			template <>
+			constexpr std::pair<uint8_t, uint8_t> node_type<messaging::usb> = { 0x3, 0x5 };
+
+			template <>
+			constexpr std::pair<uint8_t, uint8_t> node_type<messaging::lun> = { 0x3, 0x11 };
+
+			template <>
+			constexpr std::pair<uint8_t, uint8_t> node_type<messaging::sata> = { 0x3, 0x12 };
+
+			template <>
+			constexpr std::pair<uint8_t, uint8_t> node_type<messaging::nvme_namespace> = { 0x3, 0x17 };
+
+			template <>
+			constexpr std::pair<uint8_t, uint8_t> node_type<media::hard_drive> = { 0x4, 0x1 };
+
+			template <>
+			constexpr std::pair<uint8_t, uint8_t> node_type<media::file> = { 0x4, 0x4 };
+
+			template <>
+			constexpr std::pair<uint8_t, uint8_t> node_type<media::piwg_firmware_files> = { 0x4, 0x6 };
+
+			template <>
+			constexpr std::pair<uint8_t, uint8_t> node_type<media::piwg_firmware_volume> = { 0x4, 0x7 };
+
+			template <>
+			constexpr std::pair<uint8_t, uint8_t> node_type<media::relative_offset_range> = { 0x4, 0x8 };
+
+			// The nodes that read_node copies straight out of their body
+			template <typename T>
+			concept struct_node = std::is_trivially_copyable_v<T> && !std::is_same_v<T, unknown>;
+
+			void write_body(std::vector<std::byte>& output, const struct_node auto& path)
+			{
+				tcg_parser::details::write_value(output, path);
+			}
+
+			// The body of an unknown node was not kept, so it comes back as zeros of the same length
+			void write_body(std::vector<std::byte>& output, const unknown& path)
+			{
+				output.resize(size(output) + std::max<std::size_t>(path.length, sizeof(path)) - sizeof(path));
+			}
+
+			void write_body(std::vector<std::byte>& output, const acpi::extended_acpi& path)
+			{
+				auto number = [](const std::variant<uint32_t, std::u16string>& value) {
+					auto number = std::get_if<uint32_t>(&value);
+
+					return number ? *number : 0;
+				};
+
+				auto text = [](const std::variant<uint32_t, std::u16string>& value) {
+					auto text = std::get_if<std::u16string>(&value);
+
+					return text ? std::u16string_view(*text) : std::u16string_view();
+				};
+
+				tcg_parser::details::write_value(output, number(path.hid));
+				tcg_parser::details::write_value(output, number(path.uid));
+				tcg_parser::details::write_value(output, number(path.cid));
+				tcg_parser::details::write_string(output, text(path.hid));
+				tcg_parser::details::write_string(output, text(path.uid));
+				tcg_parser::details::write_string(output, text(path.cid));
+			}
+
+			void write_body(std::vector<std::byte>& output, const media::file& path)
+			{
+				tcg_parser::details::write_string(output, path.path);
+			}
+
+			// Writes the node header with the length patched in once the body is known. Fails and leaves the output
+			// as it was if the node is longer than a node can be.
+			bool write_node(std::vector<std::byte>& output, uint8_t type, uint8_t sub_type, auto&& write)
+			{
+				auto start = size(output);
+
+				output.resize(start + sizeof(unknown));
+
+				write();
+
+				if (size(output) - start > std::numeric_limits<uint16_t>::max())
+				{
+					output.resize(start);
+
+					return false;
+				}
+
+				unknown header {
+					.type = type,
+					.sub_type = sub_type,
+					.length = static_cast<uint16_t>(size(output) - start),
+				};
+
+				std::memcpy(output.data() + start, &header, sizeof(header));
+
+				return true;
+			}
+		} // namespace details
+
+		// Appends the encoding of a single node, which parse and device_path_view decode back into the same node
+		bool write(std::vector<std::byte>& output, const device_path_t& path)
+		{
+			return std::visit(
+				[&](const auto& path) {
+					using node_t = std::decay_t<decltype(path)>;
+
+					auto [type, sub_type] = details::node_type<node_t>;
+
+					if constexpr (std::is_same_v<node_t, unknown>)
+					{
+						type = path.type;
+						sub_type = path.sub_type;
+					}
+
+					return details::write_node(output, type, sub_type, [&] {
+						details::write_body(output, path);
+					});
+				},
+				path
+			);
+		}
+
+		// Appends the nodes followed by an end node
+		bool write(std::vector<std::byte>& output, std::span<const device_path_t> paths)
+		{
+			auto start = size(output);
+
+			for (auto& path : paths)
+			{
+				if (!write(output, path))
+				{
+					output.resize(start);
+
+					return false;
+				}
+			}
+
+			tcg_parser::details::write_value(output, unknown { .type = 0x7f, .sub_type = 0xff, .length = 4 });
+
+			return true;
+		}
+	} // namespace device_path
+
+	// The write_event_payload overloads append a payload in the form read_event_payload reads it from. They only
+	// fail for values that do not fit their field in the log, and leave the output as it was when they do.
+
+	bool write_event_payload(std::vector<std::byte>& output, const events::raw_event_t& event)
+	{
+		details::write_bytes(output, event.data(), size(event));
+
+		return true;
+	}
+
+	bool write_event_payload(std::vector<std::byte>& output, const events::s_crtm_version& event)
+	{
+		details::write_string(output, event.data);
+
+		return true;
+	}
+
+	bool write_event_payload(std::vector<std::byte>& output, const events::efi_spec_id& event)
+	{
+		if (size(event.vendor_info) > std::numeric_limits<uint8_t>::max()
+			|| size(event.digest_sizes) > std::numeric_limits<uint32_t>::max())
+		{
+			return false;
+		}
+
+		details::write_bytes(output, &event, offsetof(events::efi_spec_id, digest_sizes));
+		details::write_value(output, static_cast<uint32_t>(size(event.digest_sizes)));
+		details::write_bytes(
+			output,
+			event.digest_sizes.data(),
+			size(event.digest_sizes) * sizeof(events::efi_spec_id::digest_size)
+		);
+		details::write_value(output, static_cast<uint8_t>(size(event.vendor_info)));
+		details::write_bytes(output, event.vendor_info.data(), size(event.vendor_info));
+
+		return true;
+	}
+
+	// Covers EV_EFI_BOOT_SERVICES_APPLICATION, EV_EFI_BOOT_SERVICES_DRIVER and EV_EFI_RUNTIME_SERVICES_DRIVER
+	bool write_event_payload(std::vector<std::byte>& output, const events::uefi_image_load& event)
+	{
+		auto device_path = event.device_path.bytes();
+
+		details::write_bytes(output, &event, offsetof(events::uefi_image_load, device_path));
+		details::write_value(output, static_cast<uint64_t>(size(device_path)));
+		details::write_bytes(output, device_path.data(), size(device_path));
+
+		return true;
+	}
+
+	// Covers EV_EFI_VARIABLE_BOOT, EV_EFI_VARIABLE_DRIVER_CONFIG and EV_EFI_VARIABLE_AUTHORITY
+	bool write_event_payload(std::vector<std::byte>& output, const events::efi_variable_base& event)
+	{
+		details::write_value(output, event.variable_name);
+		details::write_value(output, static_cast<uint64_t>(size(event.unicode_name)));
+		details::write_value(output, static_cast<uint64_t>(size(event.variable_data)));
+		details::write_bytes(output, event.unicode_name.data(), size(event.unicode_name) * sizeof(char16_t));
+		details::write_bytes(output, event.variable_data.data(), size(event.variable_data));
+
+		return true;
+	}
+
+	bool write_event_payload(std::vector<std::byte>& output, const events::uefi_blob_1& event)
+	{
+		details::write_value(output, event);
+
+		return true;
+	}
+
+	bool write_event_payload(std::vector<std::byte>& output, const events::uefi_blob_2& event)
+	{
+		if (size(event.blob_description) > std::numeric_limits<uint8_t>::max())
+		{
+			return false;
+		}
+
+		details::write_value(output, static_cast<uint8_t>(size(event.blob_description)));
+		details::write_bytes(output, event.blob_description.data(), size(event.blob_description));
+		details::write_value(output, event.blob_base);
+		details::write_value(output, event.blob_length);
+
+		return true;
+	}
+
+	// A description is only read back as one if it is printable, and is otherwise taken for a blob
+	bool write_event_payload(std::vector<std::byte>& output, const events::post_code& event)
+	{
+		return std::visit(
+			[&](const auto& data) {
+				return write_event_payload(output, data);
+			},
+			event.data
+		);
+	}
+
+	bool write_event_payload(std::vector<std::byte>& output, const events::efi_hcrtm& event)
+	{
+		return std::visit(
+			[&](const auto& data) {
+				return write_event_payload(output, data);
+			},
+			event.data
+		);
+	}
+
+	bool write_event_payload(std::vector<std::byte>& output, const events::efi_action& event)
+	{
+		return write_event_payload(output, event.data);
+	}
+
+	// read_event_payload reads EV_IPL as UTF-16, so every character is widened
+	bool write_event_payload(std::vector<std::byte>& output, const events::ipl& event)
+	{
+		details::write_string(output, event.data);
+
+		return true;
+	}
+
+	bool write_event_payload(std::vector<std::byte>& output, const events::separator&)
+	{
+		details::write_value(output, uint32_t(0));
+
+		return true;
+	}
+
+	bool write_event_payload(std::vector<std::byte>& output, const event_payload_t& event)
+	{
+		return std::visit(
+			[&](const auto& payload) {
+				return write_event_payload(output, payload);
+			},
+			event
+		);
+	}
+
+	// Appends an event in the SHA1 log format that starts every log. The output can be reused for many events by
+	// clearing it in between, which keeps its capacity.
+	bool write_event_1(std::vector<std::byte>& output, const tcg_pgr_event_1& event)
+	{
+		auto start = size(output);
+
+		details::write_bytes(output, &event, offsetof(tcg_pgr_event_1, event));
+
+		if (!details::write_sized(output, [&] {
+				return write_event_payload(output, event.event);
+			}))
+		{
+			output.resize(start);
+
+			return false;
+		}
+
+		return true;
+	}
+
+	// Appends an event in the crypto agile log format. The digests are written as they are, so they have to match
+	// the digest sizes of the Spec ID event for the log to be readable.
+	bool write_event_2(std::vector<std::byte>& output, const tcg_pgr_event_2& event)
+	{
+		auto start = size(output);
+
+		details::write_value(output, event.pcr_index);
+		details::write_value(output, event.event_type);
+		details::write_value(output, static_cast<uint32_t>(event.digests.size()));
+
+		for (auto digest : event.digests)
+		{
+			details::write_value(output, digest.hash_alg());
+			details::write_bytes(output, digest.data(), size(digest.bytes()));
+		}
+
+		if (!details::write_sized(output, [&] {
+				return write_event_payload(output, event.event);
+			}))
+		{
+			output.resize(start);
+
+			return false;
+		}
+
+		return true;
+	}
+
+	// Encodes a whole log: the Spec ID event followed by the events
+	std::optional<std::vector<std::byte>> write_log(
+		const tcg_pgr_event_1& header,
+		std::span<const tcg_pgr_event_2> events
+	)
+	{
+		std::vector<std::byte> output;
+
+		if (!write_event_1(output, header))
+		{
+			return {};
+		}
+
+		for (auto& event : events)
+		{
+			if (!write_event_2(output, event))
+			{
+				return {};
+			}
+		}
+
+		return output;
+	}
+} // namespace tcg_parser